@@ -349,17 +349,17 @@ build_bvh(int node_idx, int first_triangle_idx, int num_triangles, int depth)
  *  - nearest_intersection: The distance to the intersection point, if an 
  *                          intersection was found. Must not be changed 
  *                          otherwise.
- *  - isect:                The intersection, if one was found. Must not be 
- *                          changed otherwise.
+ *  - hit_record:           The hit record, if an intersection was found. Must
+ *                          not be changed otherwise.
  *
  * Return value:
  *  true if an intersection was found, false otherwise.
  */
 bool BVH::
-intersect_recursive(const Ray &ray, int idx, float *nearest_intersection, Intersection* isect) const
+intersect_recursive(const Ray &ray, int idx, float *nearest_intersection, HitRecord* hit_record) const
 {
 	cg_assert(nearest_intersection);
-	cg_assert(isect);
+	cg_assert(hit_record);
 	cg_assert(idx >= 0);
 	cg_assert(idx < static_cast<int>(nodes.size()));
 
@@ -383,8 +383,9 @@ intersect_recursive(const Ray &ray, int idx, float *nearest_intersection, Inters
 					*nearest_intersection = dist;
 					bary = b;
 					cg_assert(x >= 0);
-					if(isect)
-						triangle_soup.fill_intersection(isect, x, *nearest_intersection, bary);
+					hit_record->t = *nearest_intersection;
+					hit_record->primitive_id = x;
+					hit_record->bary = glm::vec2(bary.y, bary.z);
 				}
 			}
 		}
@@ -414,38 +415,38 @@ intersect_recursive(const Ray &ray, int idx, float *nearest_intersection, Inters
 		}
 
 		if (t1hit && t2hit) {
-			Intersection isect_local_1;
-			Intersection isect_local_2;
+			HitRecord hit_local_1;
+			HitRecord hit_local_2;
 			if (t1 <= t2) {
-				if (intersect_recursive(ray, n.left, nearest_intersection, &isect_local_1)) {
-					*isect = isect_local_1;
-					if (intersect_recursive(ray, n.right, nearest_intersection, &isect_local_2)) {
-						if (isect_local_2.t < isect_local_1.t) {
-							*isect = isect_local_2;
+				if (intersect_recursive(ray, n.left, nearest_intersection, &hit_local_1)) {
+					*hit_record = hit_local_1;
+					if (intersect_recursive(ray, n.right, nearest_intersection, &hit_local_2)) {
+						if (hit_local_2.t < hit_local_1.t) {
+							*hit_record = hit_local_2;
 						}
 					}
 					return true;
 				}
-				if (intersect_recursive(ray, n.right, nearest_intersection, isect)) return true;
+				if (intersect_recursive(ray, n.right, nearest_intersection, hit_record)) return true;
 			}
 			else {
-				if (intersect_recursive(ray, n.right, nearest_intersection, &isect_local_2)) {
-					*isect = isect_local_2;
-					if (intersect_recursive(ray, n.left, nearest_intersection, &isect_local_1)) {
-						if (isect_local_1.t < isect_local_2.t) {
-							*isect = isect_local_1;
+				if (intersect_recursive(ray, n.right, nearest_intersection, &hit_local_2)) {
+					*hit_record = hit_local_2;
+					if (intersect_recursive(ray, n.left, nearest_intersection, &hit_local_1)) {
+						if (hit_local_1.t < hit_local_2.t) {
+							*hit_record = hit_local_1;
 						}
 					}
 					return true;
 				}
-				if (intersect_recursive(ray, n.left, nearest_intersection, isect)) return true;
+				if (intersect_recursive(ray, n.left, nearest_intersection, hit_record)) return true;
 			}
 		}
 		else if (t1hit) {
-			if (intersect_recursive(ray, n.left, nearest_intersection, isect)) return true;
+			if (intersect_recursive(ray, n.left, nearest_intersection, hit_record)) return true;
 		}
 		else if (t2hit){
-			if (intersect_recursive(ray, n.right, nearest_intersection, isect)) return true;
+			if (intersect_recursive(ray, n.right, nearest_intersection, hit_record)) return true;
 		}
 	}
 
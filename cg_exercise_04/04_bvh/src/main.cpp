@@ -8,9 +8,12 @@
 #include <cglib/rt/sampling_patterns.h>
 #include <cglib/rt/scene.h>
 #include <cglib/rt/raytracing_parameters.h>
+#include <cglib/rt/texture.h>
+#include <cglib/rt/texture_cache.h>
 
 #include <cglib/core/glmstream.h>
 #include <cglib/core/image.h>
+#include <cglib/core/page_cache.h>
 #include <cglib/core/parameters.h>
 #include <cglib/core/thread_local_data.h>
 #include <cglib/core/thread_local_data.h>
@@ -25,6 +28,7 @@
 #include <iostream>
 #include <stack>
 #include <complex>
+#include <random>
 
 using std::cout;
 using std::cerr;
@@ -44,36 +48,24 @@ glm::vec3 render_pixel(int x, int y, RaytracingContext const& context, RenderDat
 {
 	cg_assert(data.tld);
 
-	if(dynamic_cast<GaussScene *>(context.get_active_scene())) {
-		float u = float(x)/context.params.image_width;
-		float v = float(y)/context.params.image_height;
-		const auto &scene = context.get_active_scene();
-		const char *tex_names[RaytracingParameters::GAUSS_MODE_COUNT] = { "input", "filtered_naive", "filtered_separable" };
-		const auto &texture = scene->textures.find(tex_names[context.params.gauss_mode])->second;
-		auto &mip = texture->get_mip_levels()[0];
-		float a = float(mip->getWidth()) / float(mip->getHeight());
-		return texture->evaluate_bilinear(0, a > 1.0
-				? glm::vec2(u, v * a - (a - 1.0f) * 0.5f)
-				: glm::vec2(u / a - (1.0f - a) * 0.5f, v));
-	}
-
-	if(dynamic_cast<FourierScene *>(context.get_active_scene())) {
-		float u = float(x)/context.params.image_width;
-		float v = float(y)/context.params.image_height;
-		const auto &scene = context.get_active_scene();
-		const char *tex_names[RaytracingParameters::FOURIER_MODE_COUNT] = { "amplitude", "phase", "reconstructed" };
-		const auto &texture = scene->textures.find(tex_names[context.params.fourier_mode])->second;
-		auto &mip = texture->get_mip_levels()[0];
-		float a = float(mip->getWidth()) / float(mip->getHeight());
-		return texture->evaluate_bilinear(0, a > 1.0
-				? glm::vec2(u, v * a - (a - 1.0f) * 0.5f)
-				: glm::vec2(u / a - (1.0f - a) * 0.5f, v));
-	}
-	
 	std::vector<glm::vec2> samples;
 	int spp = data.context.params.spp;
 
-	if(spp > 1) {
+	if(data.progressive_pass >= 0) {
+		// progressive rendering: one sample per pass, HostRender accumulates.
+		// every pass, including the first, is jittered, otherwise the
+		// accumulated mean and variance would be biased towards the center.
+		glm::vec2 const offset(data.tld->rand(), data.tld->rand());
+		float fx = float(x) + offset.x;
+		float fy = float(y) + offset.y;
+
+		data.x = fx;
+		data.y = fy;
+
+		Ray ray = createPrimaryRay(data, fx, fy);
+		return trace_recursive(data, ray, 0/*depth*/);
+	}
+	else if(spp > 1) {
 		int grid_size = int(sqrtf(static_cast<float>(spp)));
 		if(data.context.params.stratified)
 			generate_stratified_samples(&samples, grid_size, grid_size, data.tld);
@@ -81,12 +73,18 @@ glm::vec3 render_pixel(int x, int y, RaytracingContext const& context, RenderDat
 			generate_random_samples(&samples, grid_size, grid_size, data.tld);
 		glm::vec3 accum(0.0f);
 
+		// hero wavelengths of the samples are evenly spaced from a random offset
+		const float wavelength_offset = data.context.params.spectral_dispersion ? data.tld->rand() : 0.f;
+
 		for(size_t i = 0; i < samples.size(); i++) {
 			float fx = float(x) + samples[i].x;
 			float fy = float(y) + samples[i].y;
 
 			data.x = fx;
 			data.y = fy;
+			if (data.context.params.spectral_dispersion) {
+				data.wavelength_sample = std::fmod(wavelength_offset + float(i) / float(samples.size()), 1.f);
+			}
 
 			Ray ray = createPrimaryRay(data, fx, fy);
 			accum += trace_recursive(data, ray, 0/*depth*/);
@@ -106,6 +104,30 @@ glm::vec3 render_pixel(int x, int y, RaytracingContext const& context, RenderDat
 	}
 }
 
+/*
+ * Tile kernel for HostRender::run that renders the pixels of a tile with
+ * render_pixel. Unlike HostRender's own kernels for render_pixel, it only
+ * supports the RECURSIVE render mode without stereo.
+ */
+static void render_tile(RaytracingContext const& context, HostRender::Tile const& tile)
+{
+	cg_assert(context.params.render_mode == RaytracingParameters::RECURSIVE);
+	cg_assert(!context.params.stereo);
+
+	for (int y = tile.y0; y < tile.y1; y++) {
+		for (int x = tile.x0; x < tile.x1; x++) {
+			if (tile.terminated())
+				return;
+			if (!tile.needs_sample(context.params, x, y))
+				continue;
+
+			RenderData data(context, tile.tld);
+			data.progressive_pass = tile.pass;
+			tile.pixel(x, y) = glm::vec4(render_pixel(x, y, context, data), 1.f);
+		}
+	}
+}
+
 static const std::string image_prefix = "assignment_images/";
 
 static void render_triangles(std::string const& output_name, int num_triangles)
@@ -119,7 +141,7 @@ static void render_triangles(std::string const& output_name, int num_triangles)
 
 	context.params.output_file_name = image_prefix + output_name;
 	context.add_scene(std::make_shared<TriangleScene>(context.params));
-	HostRender::run(context, render_pixel);
+	HostRender::run(context, render_tile);
 }
 
 static void render_monkey(std::string const& output_name)
@@ -185,6 +207,75 @@ void gauss_filter()
 	filtered_seperable.save(image_prefix+"gauss_filtered_seperable.png", 1.f);
 }
 
+/*
+ * Microbenchmark of bilinear lookups in a large texture with the linear
+ * and the tiled texel layout (see TiledImage), for lookups that walk
+ * along u, along v, and at random positions, and of mipmap creation with
+ * each filter on one and on all threads.
+ */
+void benchmark_textures()
+{
+	const int size = 2048;
+	const int num_lookups = 1 << 24;
+
+	Image img(size, size);
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> dist;
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			img.setPixel(x, y, glm::vec4(dist(rng), dist(rng), dist(rng), 1.f));
+		}
+	}
+
+	std::vector<glm::vec2> random_uvs(num_lookups);
+	for (auto& uv : random_uvs) {
+		uv = glm::vec2(dist(rng), dist(rng));
+	}
+
+	for (int filter = 0; filter < MIPMAP_FILTER_COUNT; ++filter) {
+		for (int num_threads : { 1, 0 }) {
+			ImageTexture texture(img, BILINEAR, REPEAT);
+			Timer timer;
+			timer.start();
+			texture.create_mipmap(MipmapFilter(filter), num_threads);
+			timer.stop();
+			cout << "create_mipmap " << mipmap_filter_names[filter] << ", "
+				<< (num_threads == 1 ? "1 thread" : "all threads") << ": "
+				<< timer.getElapsedTimeInMilliSec() << " ms" << endl;
+		}
+	}
+
+	ImageTexture texture(img, BILINEAR, REPEAT);
+	texture.create_mipmap();
+
+	const char* pattern_names[] = { "along u", "along v", "random" };
+	const char* layout_names[TEXTURE_LAYOUT_COUNT] = { "linear", "tiled" };
+	for (int pattern = 0; pattern < 3; ++pattern) {
+		glm::vec4 sums[TEXTURE_LAYOUT_COUNT];
+		for (int layout = 0; layout < TEXTURE_LAYOUT_COUNT; ++layout) {
+			texture.set_layout(TextureLayout(layout));
+			glm::vec4 sum(0.f);
+			Timer timer;
+			timer.start();
+			for (int i = 0; i < num_lookups; ++i) {
+				// consecutive lookups are half a texel apart
+				const float a = float(i % (2 * size)) / float(2 * size);
+				const float b = float(i / (2 * size)) / float(size);
+				const glm::vec2 uv = pattern == 0 ? glm::vec2(a, b)
+				                   : pattern == 1 ? glm::vec2(b, a)
+				                   : random_uvs[i];
+				sum += texture.evaluate_bilinear(0, uv);
+			}
+			timer.stop();
+			sums[layout] = sum;
+			cout << "bilinear " << pattern_names[pattern] << ", " << layout_names[layout] << ": "
+				<< 1e6 * timer.getElapsedTimeInMilliSec() / num_lookups << " ns per lookup"
+				<< " (checksum " << sum.x + sum.y + sum.z << ")" << endl;
+		}
+		cg_assert(sums[TEXTURE_LAYOUT_LINEAR] == sums[TEXTURE_LAYOUT_TILED]);
+	}
+}
+
 void create_images()
 {
 	render_triangles("triangle.png", 1);
@@ -201,6 +292,13 @@ main(int argc, char const**argv)
         std::cerr << "invalid command line argument" << std::endl;
         return -1;
     }
+	TextureCache::set_directory(context.params.texture_cache);
+	if (context.params.texture_memory > 0) {
+		if (context.params.texture_cache.empty())
+			std::cerr << "warning: --texture-memory requires --texture-cache, textures are not paged" << std::endl;
+		else
+			PageCache::set_budget(std::size_t(context.params.texture_memory) << 20);
+	}
 	
 	if(context.params.create_images) {
 		create_images();
@@ -214,6 +312,10 @@ main(int argc, char const**argv)
 		fourier();
 		return 0;
 	}
+	if(context.params.benchmark_textures) {
+		benchmark_textures();
+		return 0;
+	}
 
 	context.add_scene(std::make_shared<TriangleScene>(context.params));
 	context.add_scene(std::make_shared<MonkeyScene>(context.params));
@@ -1,9 +1,16 @@
 set(CGLIB_SOURCE_FILES
+	src/colors/cmf.cpp
 	src/core/camera.cpp
+	src/core/exr.cpp
 	src/core/gui.cpp
 	src/core/image.cpp
+	src/core/mapped_file.cpp
+	src/core/page_cache.cpp
+	src/core/parallel_for.cpp
 	src/core/parameters.cpp
+	src/core/shadow_cache.cpp
 	src/core/stb.cpp
+	src/core/tiled_image.cpp
 	src/core/thread_pool.cpp
 	src/core/timer.cpp
 	src/imgui/imgui.cpp
@@ -11,16 +18,22 @@ set(CGLIB_SOURCE_FILES
 	src/imgui/imgui_orient.cpp
 	src/imgui/imgui_impl_glfw_gl2.cpp
 	src/imgui/imgui_impl_glfw_gl3.cpp
+	src/rt/accumulation_buffer.cpp
+	src/rt/aov.cpp
 	src/rt/host_render.cpp
 	src/rt/material.cpp
+	src/rt/material_table.cpp
 	src/rt/object.cpp
 	src/rt/raytracing_context.cpp
 	src/rt/raytracing_parameters.cpp
 	src/rt/renderer.cpp
 	src/rt/scene.cpp
 	src/rt/light.cpp
+	src/rt/light_bvh.cpp
 	src/rt/sampling_patterns.cpp
+	src/rt/spectrum.cpp
 	src/rt/texture.cpp
+	src/rt/texture_cache.cpp
 	src/rt/texture_mapping.cpp
 	src/core/obj_mesh.cpp
 	src/rt/bvh.cpp
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+class Image;
+
+/*
+ * One channel of an OpenEXR file, taken from the given component
+ * (0 = red, ..., 3 = alpha) of an image.
+ *
+ * Use "layer.channel" names (e.g. "normal.X") for multi-layer files.
+ */
+struct ExrChannel
+{
+	std::string name;
+	Image const* image;
+	int component;
+};
+
+/*
+ * Write an uncompressed scanline OpenEXR file with 32 bit float channels.
+ * All images must have the same size.
+ */
+bool save_exr(std::string const& path, std::vector<ExrChannel> channels);
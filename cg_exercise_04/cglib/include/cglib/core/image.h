@@ -31,8 +31,15 @@ public:
 
 	void save(std::string const& path, float gamma) const;
 	void load(std::string const& path, float gamma);
+
+	/*
+	 * true if load would read floating point data from the file (e.g. .hdr),
+	 * false for 8 bit images.
+	 */
+	static bool is_hdr(std::string const& path);
 	
-	void save_pfm(std::string const& path) const;
+	// returns false if the file could not be written
+	bool save_pfm(std::string const& path) const;
 	void load_pfm(std::string const& path);
 
 	void tonemap_01(float exposure, float gamma);
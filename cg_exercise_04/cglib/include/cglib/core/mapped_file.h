@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * Read-only memory mapping of a whole file. The pages of the file are read
+ * when they are first accessed. Where mmap is not available, the file is
+ * read into memory instead.
+ */
+class MappedFile
+{
+public:
+	/*
+	 * nullptr if the file can not be opened or is empty.
+	 */
+	static std::shared_ptr<MappedFile> open(std::string const& path);
+
+	~MappedFile();
+
+	void const* data() const { return m_data; }
+	std::size_t size() const { return m_size; }
+
+private:
+	MappedFile() {}
+	MappedFile(MappedFile const&) = delete;
+	MappedFile& operator=(MappedFile const&) = delete;
+
+	void const* m_data = nullptr;
+	std::size_t m_size = 0;
+	std::vector<char> m_buffer; // the file contents without mmap
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/*
+ * Cache of the pages of read-only files, shared by all threads.
+ *
+ * Pages of PAGE_SIZE bytes are read from the file when they are first
+ * fetched and evicted in least recently used order when the pages in the
+ * cache exceed the budget. Each thread additionally holds on to the last
+ * few pages it fetched, so the memory used can exceed the budget by
+ * THREAD_PAGES pages per thread.
+ */
+class PageCache
+{
+public:
+	static const std::size_t PAGE_SIZE = 64 * 1024;
+	static const int THREAD_PAGES = 16;
+
+	/*
+	 * A file opened for paging.
+	 */
+	class File
+	{
+	public:
+		~File();
+		std::size_t size() const { return m_size; }
+
+		/*
+		 * Read size bytes at offset into dst, bypassing the cache.
+		 */
+		bool read(std::size_t offset, std::size_t size, void* dst) const;
+
+	private:
+		friend class PageCache;
+		File() {}
+		File(File const&) = delete;
+		File& operator=(File const&) = delete;
+
+		std::uint64_t m_id = 0; // unique, also after the file is closed
+		std::size_t m_size = 0;
+		int m_fd = -1;
+		std::string m_path;
+	};
+
+	/*
+	 * nullptr if the file can not be opened.
+	 */
+	static std::shared_ptr<File> open(std::string const& path);
+
+	/*
+	 * Memory budget in bytes. 0 (the default) disables paging, see enabled.
+	 */
+	static void set_budget(std::size_t bytes);
+	static std::size_t get_budget();
+	static bool enabled() { return get_budget() > 0; }
+
+	/*
+	 * Pointer to the byte at offset of file, loading its page if necessary.
+	 * The pointer is valid until the next call of fetch on the same thread
+	 * and only for the rest of the page. Reads past the end of the file
+	 * return zeros.
+	 */
+	static void const* fetch(File const& file, std::size_t offset);
+
+	struct Stats
+	{
+		std::uint64_t hits = 0;      // fetches of pages that were in the cache
+		std::uint64_t misses = 0;    // fetches that read the page from the file
+		std::uint64_t evictions = 0;
+		std::size_t resident_bytes = 0;
+		std::size_t peak_resident_bytes = 0;
+	};
+
+	/*
+	 * Fetches served by the pages each thread holds on to are not counted.
+	 */
+	static Stats get_stats();
+	static void reset_stats();
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Threads that run several parallel loops one after another, e.g. one per
+ * mip level, without starting new threads for each loop. The thread that
+ * calls run works, too, so num_threads - 1 threads are started. Uses the
+ * number of hardware threads if num_threads <= 0.
+ */
+class ParallelFor
+{
+public:
+	explicit ParallelFor(int num_threads = 0);
+	~ParallelFor();
+
+	ParallelFor(ParallelFor const&) = delete;
+	ParallelFor& operator=(ParallelFor const&) = delete;
+
+	int get_num_threads() const { return int(threads.size()) + 1; }
+
+	/*
+	 * Call f(i) for all i in [0, n). Indices are handed out one at a time,
+	 * so each call should do a reasonable amount of work.
+	 *
+	 * Returns when all calls are done. The first exception thrown by f is
+	 * rethrown.
+	 */
+	void run(int n, std::function<void(int)> const& f);
+
+private:
+	void work();
+	void worker();
+
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable start;     // a loop was started, or the threads quit
+	std::condition_variable finished;  // a thread finished its part of the loop
+	std::function<void(int)> const* loop = nullptr;
+	int n = 0;
+	int next = 0;                      // next index of the loop
+	int generation = 0;                // number of loops started
+	int working = 0;                   // started threads still in the loop
+	bool quit = false;
+	std::exception_ptr exception;
+};
+
+/*
+ * Call f(i) for all i in [0, n) on up to num_threads threads, or on the
+ * number of hardware threads if num_threads <= 0. Indices are handed out
+ * one at a time, so each call should do a reasonable amount of work.
+ *
+ * Returns when all calls are done. The first exception thrown by f is
+ * rethrown.
+ */
+void parallel_for(int n, std::function<void(int)> const& f, int num_threads = 0);
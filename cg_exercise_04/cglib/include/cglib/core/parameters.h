@@ -42,6 +42,12 @@ public:
 	// Output filename (used for noninteractive renders).
 	std::string output_file_name = "output.tga";
 
+	// Comma separated list of AOVs that noninteractive renders write in
+	// addition to the image (e.g. "color,normal,depth"), see cglib/rt/aov.h.
+	std::string aovs;
+	// .exr writes all AOVs into one multi-layer file, .pfm one file per AOV.
+	std::string aov_file_name = "aovs.exr";
+
 	// The size of a render tile.
 	std::uint32_t tile_size = 32;
 
@@ -52,6 +58,14 @@ public:
 	bool interactive = true;
 	bool gauss = false;
 	bool fourier = false;
+	bool benchmark_textures = false;
+	// Block compress 8 bit textures when loading scenes, see ImageTexture::compress.
+	bool compress_textures = false;
+	// Directory of the texture cache (see TextureCache), disabled if empty.
+	std::string texture_cache;
+	// Memory budget of paged textures in MB (see PageCache), 0 loads
+	// textures completely. Requires the texture cache.
+	int texture_memory = 0;
 
 	float exposure = 0.0f;
 	float gamma = 2.2f;
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Per thread cache of the primitive that last blocked a shadow ray towards
+ * each light. Neighboring shading points are usually shadowed by the same
+ * primitive, so visible() tests it before traversing the scene.
+ *
+ * The counters of all threads are summed up in process wide statistics,
+ * which HostRender prints after rendering.
+ */
+struct ShadowCache
+{
+	struct Entry
+	{
+		int32_t object_id = -1;    // index into Scene::objects, -1 if empty
+		uint32_t primitive_id = 0;
+	};
+
+	std::vector<Entry> entries; // indexed by light
+	std::uint64_t lookups = 0;  // shadow rays towards a light
+	std::uint64_t hits = 0;     // lookups blocked by the cached primitive
+
+	Entry& lookup(int light)
+	{
+		if (std::size_t(light) >= entries.size())
+			entries.resize(light + 1);
+		++lookups;
+		return entries[light];
+	}
+
+	/*
+	 * add the counters to the statistics and reset them
+	 */
+	void flush_stats();
+
+	static void reset_stats();
+	static std::uint64_t total_lookups();
+	static std::uint64_t total_hits();
+};
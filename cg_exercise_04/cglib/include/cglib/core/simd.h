@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CGLIB_SIMD_SSE
+#include <emmintrin.h>
+#endif
+
+/*
+ * Four floats processed with one SSE instruction per operation, e.g. the
+ * channels of an RGBA pixel. Falls back to scalar code without SSE.
+ */
+struct float4
+{
+#ifdef CGLIB_SIMD_SSE
+	__m128 v;
+
+	float4() {}
+	explicit float4(__m128 v_) : v(v_) {}
+	explicit float4(float f) : v(_mm_set1_ps(f)) {}
+	explicit float4(glm::vec4 const& p) : v(_mm_loadu_ps(&p[0])) {}
+	explicit float4(float const* p) : v(_mm_loadu_ps(p)) {}
+
+	void store(glm::vec4* p) const { _mm_storeu_ps(&(*p)[0], v); }
+	void store(float* p) const { _mm_storeu_ps(p, v); }
+
+	friend float4 operator+(float4 a, float4 b) { return float4(_mm_add_ps(a.v, b.v)); }
+	friend float4 operator-(float4 a, float4 b) { return float4(_mm_sub_ps(a.v, b.v)); }
+	friend float4 operator*(float4 a, float4 b) { return float4(_mm_mul_ps(a.v, b.v)); }
+	friend float4 min(float4 a, float4 b) { return float4(_mm_min_ps(a.v, b.v)); }
+	friend float4 max(float4 a, float4 b) { return float4(_mm_max_ps(a.v, b.v)); }
+
+	// exact for |a| < 2^31
+	friend float4 floor(float4 a)
+	{
+		const __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+		return float4(_mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.f))));
+	}
+#else
+	glm::vec4 v;
+
+	float4() {}
+	explicit float4(float f) : v(f) {}
+	explicit float4(glm::vec4 const& p) : v(p) {}
+	explicit float4(float const* p) : v(p[0], p[1], p[2], p[3]) {}
+
+	void store(glm::vec4* p) const { *p = v; }
+	void store(float* p) const { p[0] = v[0]; p[1] = v[1]; p[2] = v[2]; p[3] = v[3]; }
+
+	friend float4 operator+(float4 a, float4 b) { return float4(a.v + b.v); }
+	friend float4 operator-(float4 a, float4 b) { return float4(a.v - b.v); }
+	friend float4 operator*(float4 a, float4 b) { return float4(a.v * b.v); }
+	friend float4 min(float4 a, float4 b) { return float4(glm::min(a.v, b.v)); }
+	friend float4 max(float4 a, float4 b) { return float4(glm::max(a.v, b.v)); }
+	friend float4 floor(float4 a) { return float4(glm::floor(a.v)); }
+#endif
+
+	float4& operator+=(float4 b) { return *this = *this + b; }
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cglib/core/shadow_cache.h>
+
 #include <random>
 
 /*
@@ -16,6 +18,8 @@ struct ThreadLocalData
 	// Random number generation.
 	std::mt19937                          rng;
 	std::uniform_real_distribution<float> dist;
+
+	ShadowCache shadow_cache;
 	
 	ThreadLocalData() {}
 
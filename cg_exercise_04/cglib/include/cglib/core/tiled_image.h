@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cglib/core/page_cache.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class Image;
+
+/*
+ * Image stored in blocks of BLOCK_SIZE x BLOCK_SIZE pixels.
+ *
+ * The blocks are stored row by row, the pixels within a block in Morton (Z)
+ * order. The four pixels of a bilinear lookup thus usually lie within one
+ * block, instead of in two rows that are a full image width apart. Width
+ * and height are padded to multiples of the block size.
+ *
+ * Pixels are stored in one of several formats, getPixel decodes them.
+ * The block compressed formats BC1 and BC3 use the bit layout of the GPU
+ * formats of the same name and store one compressed block per tile.
+ */
+class TiledImage
+{
+public:
+	static const int BLOCK_SIZE = 4;
+
+	enum Format {
+		RGBA32F, // 16 bytes per pixel, exact
+		RGBA16F, // 8 bytes per pixel, half floats for HDR images
+		RGBA8,   // 4 bytes per pixel for LDR images, color gamma encoded and
+		         // decoded with a lookup table, alpha linear
+		BC1,     // 0.5 bytes per pixel, color of RGBA8 compressed, opaque
+		BC3,     // 1 byte per pixel, BC1 color and compressed alpha
+		FORMAT_COUNT
+	};
+
+	static const char* format_names[FORMAT_COUNT];
+
+	static bool is_compressed(Format format) { return format == BC1 || format == BC3; }
+
+	TiledImage();
+
+	/*
+	 * gamma is the exponent that decodes the 8 bit color channels of RGBA8,
+	 * BC1 and BC3, as passed to Image::load.
+	 */
+	explicit TiledImage(Image const& image, Format format = RGBA32F, float gamma = 1.f);
+
+	/*
+	 * Image that uses the encoded pixels at data (see getData) instead of
+	 * a copy, e.g. in a mapped file. owner keeps data alive. setPixel
+	 * copies the pixels first.
+	 */
+	TiledImage(int width, int height, Format format, float gamma,
+		std::shared_ptr<void const> owner, void const* data);
+
+	/*
+	 * Image whose encoded pixels are at offset in file and are loaded
+	 * through the PageCache on access. offset must be a multiple of 16.
+	 * setPixel reads all pixels first.
+	 */
+	TiledImage(int width, int height, Format format, float gamma,
+		std::shared_ptr<PageCache::File> file, std::size_t offset);
+
+	TiledImage(TiledImage const& other);
+	TiledImage(TiledImage&& other) = default;
+	TiledImage& operator=(TiledImage const& other);
+	TiledImage& operator=(TiledImage&& other) = default;
+
+	int getWidth() const { return m_width; }
+	int getHeight() const { return m_height; }
+	Format getFormat() const { return m_format; }
+	float getGamma() const { return m_gamma; }
+
+	/*
+	 * the encoded pixels, memory_size() bytes. nullptr for paged images.
+	 */
+	void const* getData() const { return m_data; }
+	bool is_paged() const { return bool(m_file); }
+
+	glm::vec4 getPixel(int i, int j) const;
+
+	/*
+	 * the pixels (i0, j0), (i0, j1), (i1, j0) and (i1, j1) of e.g. a
+	 * bilinear lookup, with one test of the format for all four
+	 */
+	void getPixels(int i0, int i1, int j0, int j1, glm::vec4 out[4]) const;
+
+	/*
+	 * For compressed formats, this re-encodes the whole block of the pixel.
+	 */
+	void setPixel(int i, int j, const glm::vec4& pixel);
+
+	/*
+	 * decode all pixels into image
+	 */
+	void copy_to(Image* image) const;
+
+	/*
+	 * size of the pixel storage in bytes
+	 */
+	std::size_t memory_size() const { return m_size; }
+
+	/*
+	 * peak signal to noise ratio of the decoded pixels compared to the
+	 * pixels of reference in dB, with a peak value of 1. Infinite if the
+	 * images are equal.
+	 */
+	double psnr(TiledImage const& reference) const;
+
+private:
+	int index(int i, int j) const
+	{
+		// Morton order of the 4x4 pixels: y1 x1 y0 x0
+		const int x = i & (BLOCK_SIZE - 1);
+		const int y = j & (BLOCK_SIZE - 1);
+		const int morton = (x & 1) | ((y & 1) << 1) | ((x & 2) << 1) | ((y & 2) << 2);
+		const int block = (j / BLOCK_SIZE) * m_blocks_x + (i / BLOCK_SIZE);
+		return block * BLOCK_SIZE * BLOCK_SIZE + morton;
+	}
+
+	/*
+	 * pointer to pixel (or block) i. For paged images, it is valid until
+	 * the next access on the same thread, for the pixels in the same 16
+	 * bytes.
+	 */
+	template <class T> T const* pixels(std::size_t i) const
+	{
+		if (!m_file)
+			return static_cast<T const*>(m_data) + i;
+		return static_cast<T const*>(PageCache::fetch(*m_file, m_offset + i * sizeof(T)));
+	}
+	template <class T> T* mutable_pixels();
+
+	std::uint32_t encode_rgba8(glm::vec4 const& pixel) const;
+	glm::vec4 decode_rgba8(std::uint32_t p) const
+	{
+		return glm::vec4(m_lut[p & 0xff], m_lut[(p >> 8) & 0xff], m_lut[(p >> 16) & 0xff],
+			float(p >> 24) / 255.0f);
+	}
+	glm::vec4 decode_compressed(int i, int j) const;
+	void encode_block(int block, glm::vec4 const pixels[BLOCK_SIZE * BLOCK_SIZE]);
+
+	int m_width;
+	int m_height;
+	int m_blocks_x;
+	Format m_format;
+	float m_gamma;
+	float const* m_lut; // decoded value of each 8 bit color value for RGBA8, BC1 and BC3
+
+	// The pixels, in m_storage, kept alive by m_owner or at m_offset in
+	// m_file. Per format:
+	// RGBA32F glm::vec4, RGBA16F packed half floats (std::uint64_t),
+	// RGBA8 std::uint32_t, BC1 color block, BC3 alpha and color block
+	// (std::uint64_t each) per block.
+	std::vector<std::uint64_t> m_storage;
+	std::shared_ptr<void const> m_owner;
+	void const* m_data;
+	std::size_t m_size;
+	std::shared_ptr<PageCache::File> m_file;
+	std::size_t m_offset;
+};
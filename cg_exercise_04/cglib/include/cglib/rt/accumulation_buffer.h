@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/*
+ * Per-pixel running mean and variance (Welford's algorithm) of all samples
+ * rendered so far.
+ *
+ * Used by HostRender for progressive rendering: every pass adds one
+ * sample per pixel, the frame buffer displays the current mean. With
+ * adaptive sampling, the variance decides which pixels get more samples.
+ */
+class AccumulationBuffer
+{
+public:
+	AccumulationBuffer(int width, int height);
+
+	int getWidth() const { return m_width; }
+	int getHeight() const { return m_height; }
+
+	void clear();
+
+	void add_sample(int x, int y, glm::vec3 const& color);
+
+	glm::vec3 const& get_mean(int x, int y) const;
+	glm::vec3 get_variance(int x, int y) const;
+	int get_num_samples(int x, int y) const;
+
+	/*
+	 * Standard error of the mean luminance, relative to the mean luminance.
+	 * Returns infinity if there are less than two samples.
+	 */
+	float get_relative_error(int x, int y) const;
+
+	long long get_total_samples() const { return m_total_samples; }
+
+private:
+	int m_width;
+	int m_height;
+	std::vector<glm::vec3> m_mean;
+	std::vector<glm::vec3> m_m2; // sum of squared differences from the mean
+	std::vector<int> m_num_samples;
+	long long m_total_samples = 0;
+};
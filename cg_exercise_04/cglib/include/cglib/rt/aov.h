@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cglib/core/image.h>
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+class Intersection;
+
+/*
+ * Arbitrary output variables (AOVs): per pixel buffers that are
+ * written in the same pass as the color.
+ */
+enum AOV
+{
+	AOV_COLOR,
+	AOV_NORMAL,       // normal at the primary hit, as in the NORMAL render mode but not remapped
+	AOV_DEPTH,        // distance to the primary hit, 0 if there is none
+	AOV_UV,
+	AOV_PRIMITIVE_ID, // -1 if there is no hit
+	AOV_MATERIAL_ID,  // index into the material table of the scene, -1 if there is none
+	AOV_RAY_COUNT,    // RenderData::num_cast_rays, summed over all samples
+	AOV_TIME,         // render time in milliseconds, summed over all samples
+	AOV_COUNT
+};
+
+/*
+ * One float image per requested AOV.
+ */
+class AOVBuffers
+{
+public:
+	/*
+	 * aovs is a bit mask, bit i enables the AOV i.
+	 */
+	AOVBuffers(int width, int height, unsigned aovs);
+
+	static char const* get_name(AOV aov);
+
+	/*
+	 * Convert a comma separated list of AOV names (e.g. "color,normal,depth")
+	 * to a bit mask. Returns false if a name is unknown.
+	 */
+	static bool parse(std::string const& names, unsigned* aovs);
+
+	bool has(AOV aov) const { return (aovs >> aov) & 1u; }
+	Image const& get(AOV aov) const;
+
+	/*
+	 * Store the AOVs of one sample of pixel (x, y). Different threads may
+	 * add samples of different pixels concurrently.
+	 *
+	 * isect is RenderData::isect after rendering the pixel, i.e. the primary
+	 * hit of the last of its samples that hit anything. With several
+	 * samples per pixel, the geometric AOVs thus belong to one sample and
+	 * are not filtered over the pixel. ray count and time are summed.
+	 */
+	void add_sample(int x, int y, Intersection const& isect, bool normal_mapping,
+		int num_rays, float time_ms);
+
+	/*
+	 * The color is taken from the final frame buffer, as samples of several
+	 * passes are accumulated there.
+	 */
+	void set_color(Image const& frame_buffer);
+
+	/*
+	 * Save all AOVs. An .exr path is written as one multi-layer file, for
+	 * other extensions each AOV is saved as PFM, with its name inserted
+	 * before the extension (e.g. aovs.normal.pfm).
+	 */
+	bool save(std::string const& path) const;
+
+private:
+	unsigned aovs;
+	std::vector<Image> images; // indexed by AOV, empty if not requested
+};
@@ -60,7 +60,21 @@ public:
 	/*
 	 * Intersect the given ray with this bvh.
 	 */
-    bool intersect(Ray const& ray, Intersection* isect) const override;
+	using Object::intersect;
+    bool intersect(Ray const& ray, HitRecord* hit) const override;
+
+	/*
+	 * Traverse the BVH once for both rays. A node is visited if either
+	 * ray intersects its bounding box.
+	 */
+    unsigned intersect_pair(Ray const rays[2], HitRecord hits[2]) const override;
+
+	/*
+	 * Stop the traversal at the first triangle hit closer than t_max.
+	 */
+    bool occluded(Ray const& ray, float t_max, HitRecord* hit) const override;
+    bool intersect_primitive(Ray const& ray, uint32_t primitive_id, HitRecord* hit) const override;
+    void fill_intersection(Ray const& ray, HitRecord const& hit, Intersection* isect) const override;
     
 	/*
 	 * For the given intersection, compute additional information needed
@@ -75,9 +89,14 @@ public:
 	 */
 	void sanity_checks();
 
+	/*
+	 * evaluate the material of the intersected triangle.
+	 */
+	void evaluate_material(Intersection* isect) const;
+
 	void build_bvh(int node_idx, int first_triangle_idx, int num_triangles, int depth);
 	int reorder_triangles_median(int first_triangle_idx, int num_triangles, int axis);
-	bool intersect_recursive(const Ray &ray, int idx, float *t_max, Intersection* isect) const;
+	bool intersect_recursive(const Ray &ray, int idx, float *t_max, HitRecord* hit) const;
 
 	/*
 	 * Used for debug visualization. Maps the number of AABBs that can be
@@ -86,6 +105,15 @@ public:
 	glm::vec3 intersect_count(const Ray &ray, int idx, int depth);
 
 private:
-	bool intersect_local(Ray const& ray, Intersection* isect) const;
+	enum { MAX_TRAVERSAL_STACK = 64 };
+
+	bool intersect_local(Ray const& ray, HitRecord* hit) const;
+	unsigned intersect_pair_local(Ray const rays[2], HitRecord hits[2]) const;
+
+	/*
+	 * factor that converts distances along the object space version of
+	 * the world space ray into world space distances
+	 */
+	float world_distance_scale(Ray const& ray) const;
 };
 
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+
+/*
+ * Compact result of a ray traversal.
+ *
+ * Traversal only tracks the closest hit using this record. The full
+ * Intersection (position, tangent frame, material, ...) is computed once
+ * for the final hit by Object::fill_intersection.
+ */
+struct HitRecord
+{
+	bool isValid() const
+	{
+		return t != std::numeric_limits<float>::max();
+	}
+
+	float t = std::numeric_limits<float>::max(); // distance along the ray
+	uint32_t primitive_id = 0;                    // only used for triangle meshes
+	glm::vec2 bary = glm::vec2(0.f);              // barycentric coordinates (y, z) of triangle hits, x = 1 - y - z
+	int32_t object_id = -1;                       // index into Scene::objects, set by the caller
+};
@@ -9,6 +9,8 @@
 #include <cglib/rt/raytracing_context.h>
 #include <cglib/rt/scene.h>
 #include <cglib/rt/render_data.h>
+#include <cglib/rt/accumulation_buffer.h>
+#include <cglib/rt/aov.h>
 
 #include <cglib/core/assert.h>
 #include <chrono>
@@ -31,6 +33,9 @@ class HostRender
 		 * The parameters to the pixel function are:
 		 * int x, int y         (pixel coordinates)
 		 * centext const&       (The current context (scene+parameters)).
+		 *
+		 * Plain functions are called directly, other callables through
+		 * the std::function.
 		 */
 		typedef std::function<glm::vec3(int, int, RaytracingContext const&, RenderData &)> PixelFunc;
 
@@ -39,13 +44,89 @@ class HostRender
 					   int kill_timeout_seconds = 0,
 					   std::function<void()> const& render_overlay = []() {} );
 
+		/*
+		 * The pixels [x0, x1) x [y0, y1) of the image that one thread renders,
+		 * and the output span for them.
+		 *
+		 * The color of pixel (x, y) goes to pixel(x, y) with alpha 1. Pixels
+		 * for which needs_sample() is false have to be skipped, they keep
+		 * alpha 0 and are not accumulated.
+		 */
+		struct Tile
+		{
+			int x0, y0, x1, y1;
+			glm::vec4* pixels;                  // (x1-x0) * (y1-y0) pixels, row by row
+			ThreadLocalData* tld;
+			int pass;                           // progressive pass, -1 if all samples are rendered at once
+			AccumulationBuffer const* accum;    // nullptr if all pixels are sampled
+			std::atomic<bool> const* terminate; // set if the result is not needed anymore
+			AOVBuffers* aovs;                   // AOVs to write in addition to the color, nullptr if none
+
+			glm::vec4& pixel(int x, int y) const { return pixels[(y - y0) * (x1 - x0) + (x - x0)]; }
+			bool terminated() const { return terminate->load(); }
+			bool needs_sample(RaytracingParameters const& params, int x, int y) const
+			{
+				return !accum || HostRender::needs_sample(*accum, params, x, y);
+			}
+		};
+
+		/*
+		 * Renders all pixels of a tile. Renderers can batch rays and keep
+		 * state over the whole tile. Unlike a PixelFunc, the tile function
+		 * is responsible for all render modes itself.
+		 */
+		typedef void (*TileFunc)(RaytracingContext const&, Tile const&);
+
+		static int run(RaytracingContext& context, 
+				       TileFunc render_tile, 
+					   int kill_timeout_seconds = 0,
+					   std::function<void()> const& render_overlay = []() {} );
+
 	private:
-		typedef std::function<glm::vec3(int, int, RaytracingContext const&, ThreadLocalData*)> PixelFuncRaw;
+		/*
+		 * The function that renders the image, exactly one of them is set.
+		 */
+		struct RenderFunc
+		{
+			PixelFunc const* pixel = nullptr;
+			TileFunc tile = nullptr;
+		};
+
+		/*
+		 * Scene and render mode dependent state of one launch.
+		 */
+		struct LaunchState;
+
+		/*
+		 * There is one kernel per render mode that adapts the PixelFunc,
+		 * and one that calls the TileFunc. It is selected once per launch.
+		 */
+		typedef void (*TileKernel)(LaunchState const& state, Tile const& tile);
+
+		template <int Mode>
+		static glm::vec3 render_pixel_in_mode(LaunchState const& state, int x, int y, ThreadLocalData* tld);
+		template <int Mode>
+		static void render_tile_per_pixel(LaunchState const& state, Tile const& tile);
+		static void render_tile(LaunchState const& state, Tile const& tile);
+		static void render_tile_aovs(LaunchState const& state, Tile const& tile);
+		static TileKernel select_tile_kernel(LaunchState const& state);
+
+		static int run(RaytracingContext& context, RenderFunc const& render_func,
+			int kill_timeout_seconds, std::function<void()> const& render_overlay);
+
+		static bool renders_in_passes(RaytracingParameters const& params)
+		{
+			return params.progressive || params.adaptive_sampling;
+		}
+		static bool needs_sample(AccumulationBuffer const& accum, RaytracingParameters const& params, int x, int y);
+		static bool continue_passes(AccumulationBuffer const& accum, long long samples_before_pass,
+			RaytracingParameters const& params, int pass);
 		static void generate_tile_idx(int num_tiles_x, int num_tiles_y, std::vector<glm::ivec2>* tile_idx);
-		static int run_interactive(RaytracingContext& context, PixelFuncRaw const& render_pixel, 
+		static int run_interactive(RaytracingContext& context, RenderFunc const& render_func, 
 			std::function<void()> const& render_overlay = []() {} );
 		static int run_noninteractive(RaytracingContext& context, 
-			PixelFuncRaw const& render_pixel,
+			RenderFunc const& render_func,
 			int kill_timeout_seconds);
-		static void launch(Image* fb, ThreadPool& thread_pool, RaytracingContext const* context, std::vector<glm::ivec2>* tile_idx, PixelFuncRaw render_pixel);
+		static void launch(Image* fb, ThreadPool& thread_pool, RaytracingContext* context, std::vector<glm::ivec2>* tile_idx, RenderFunc const& render_func,
+			AccumulationBuffer* accum = nullptr, int pass = -1, AOVBuffers* aovs = nullptr);
 };
@@ -7,6 +7,11 @@
 class Intersectable
 {
 public:
+    /*
+     * only compute the distance t to the intersection. This is used during
+     * traversal, the full intersection is computed for the closest hit only.
+     */
+    virtual bool intersect(Ray const& ray, float* t) const = 0;
     virtual bool intersect(Ray const& ray, Intersection* isect) const = 0;
 };
 
@@ -20,6 +25,11 @@ public:
     {
     }
 
+    bool intersect(Ray const& ray, float* t) const
+    {
+        return intersect_sphere(ray.origin, ray.direction, center, radius, t);
+    }
+
     bool intersect(Ray const& ray, Intersection* isect) const
     {
         float t;
@@ -49,6 +59,11 @@ public:
     {
     }
 
+    bool intersect(Ray const& ray, float* t) const
+    {
+        return intersect_plane(ray.origin, ray.direction, center, normal, t);
+    }
+
     bool intersect(Ray const& ray, Intersection* isect) const
     {
         float t;
@@ -85,6 +100,18 @@ public:
     {
     }
 
+    bool intersect(Ray const& ray, float* t) const
+    {
+        if (intersect_plane(ray.origin, ray.direction, center, normal, t))
+        {
+            const glm::vec3 d = ray.origin + *t * ray.direction - p;
+            const float u = glm::dot(d, e0) / (len_e0_sq);
+            const float v = glm::dot(d, e1) / (len_e1_sq);
+            return u >= 0.f && u <= 1.f && v >= 0.f && v <= 1.f;
+        }
+        return false;
+    }
+
     bool intersect(Ray const& ray, Intersection* isect) const
     {
         float t;
@@ -34,5 +34,6 @@ public:
     glm::vec2 uv = glm::vec2(0.0f);                   // uv texture coordinates at the intersection point
     glm::vec2 dudv = glm::vec2(0.0f);                 // side lengths of the pixel footprint's AABB in uv space (for mipmap filter)
     uint32_t primitive_id;          // only used for triangle meshes
+    int32_t material_id = -1;       // index into the material table of the scene, see Scene::compile_materials
     float t;
 };
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cglib/rt/aabb.h>
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+class Light;
+
+/*
+ * Bounding volume hierarchy over the lights of a scene, used to pick lights
+ * proportional to an estimate of their contribution to a shading point
+ * (see RaytracingParameters::light_sampling).
+ *
+ * Each node bounds the positions and the summed power of its lights. A light
+ * is sampled by one descent from the root, choosing a child with probability
+ * proportional to its importance: the power divided by the squared distance
+ * to the bounds, weighted with the largest cosine between the normal and any
+ * direction into the bounds. The lights are point lights emitting into all
+ * directions, so there is no bound on the emission direction.
+ */
+class LightBVH
+{
+public:
+	/*
+	 * (re)build the hierarchy. Has to be called whenever lights change.
+	 */
+	void build(std::vector<std::unique_ptr<Light>> const& lights);
+
+	bool empty() const { return nodes.empty(); }
+
+	/*
+	 * Sample a light for the point P with normal N, using the uniform random
+	 * number u in [0, 1). Returns the index of the light and stores the
+	 * probability of having chosen it in pdf, or returns -1 if no light can
+	 * contribute. With two_sided, lights behind the surface are not
+	 * down-weighted, e.g. because of the ambient term.
+	 */
+	int sample(glm::vec3 const& P, glm::vec3 const& N, bool two_sided, float u, float* pdf) const;
+
+private:
+	struct Node
+	{
+		AABB aabb;
+		float power = 0.f; // summed power (largest color channel) of all lights
+		int left    = -1;  // right child is left + 1
+		int light   = -1;  // index into Scene::lights for leaves, -1 for inner nodes
+	};
+
+	struct BuildLight
+	{
+		glm::vec3 position;
+		float power;
+		int index;
+	};
+
+	void build_recursive(int node_idx, std::vector<BuildLight>& lights, int begin, int end);
+	float importance(Node const& node, glm::vec3 const& P, glm::vec3 const& N, bool two_sided) const;
+
+	std::vector<Node> nodes;
+};
@@ -4,6 +4,7 @@
 #include <cglib/rt/texture_mapping.h>
 
 class Intersection;
+class RaytracingParameters;
 
 class Material
 {
@@ -32,7 +33,33 @@ public:
 class MaterialSample
 {
 public:
-    void evaluate(Material const& material, Intersection const& isect);
+    enum EvaluationFlags {
+        EVALUATE_REFLECTANCE = 1 << 0, // k_a, k_d, k_s, k_r and k_t
+        EVALUATE_NORMAL_MAP  = 1 << 1,
+        EVALUATE_ALL         = EVALUATE_REFLECTANCE | EVALUATE_NORMAL_MAP
+    };
+
+    /*
+     * Evaluate the parts of the material selected by flags, the others are
+     * set to zero (normal: unperturbed).
+     */
+    void evaluate(Material const& material, Intersection const& isect, unsigned flags = EVALUATE_ALL);
+
+    /*
+     * The parts of the material that the render mode and the shading settings use.
+     */
+    static unsigned required_flags(RaytracingParameters const& params);
+
+    /*
+     * convert a normal map texel to a tangent space normal
+     */
+    static glm::vec3 decode_normal(glm::vec3 const& texel);
+
+    /*
+     * derive k_a from k_d and scale all reflectances such that
+     * they sum up to at most one
+     */
+    void normalize();
     
     glm::vec3 k_a = glm::vec3(0.0f); // ambient reflectance
     glm::vec3 k_d = glm::vec3(0.0f); // diffuse reflectance
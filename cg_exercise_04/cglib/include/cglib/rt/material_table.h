@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cglib/rt/material.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class Intersection;
+class ImageTexture;
+
+/*
+ * The materials of a scene, compiled into contiguous memory.
+ *
+ * Constant channels are stored inline, textured channels refer to a texture
+ * by a small index. Shading with the table does not touch any shared_ptr
+ * and dispatches on the texture type with a switch instead of a virtual call.
+ * The textures are owned by the scene, the table only stores pointers.
+ */
+class MaterialTable
+{
+public:
+	struct Channel
+	{
+		enum Type : int32_t {
+			CONSTANT, // value
+			IMAGE,    // images[texture]
+			GENERIC   // generic_textures[texture], evaluated through the virtual call
+		};
+
+		glm::vec3 value = glm::vec3(0.f);
+		Type type = CONSTANT;
+		int32_t texture = -1;
+	};
+
+	struct CompiledMaterial
+	{
+		Channel k_d;
+		Channel k_s;
+		Channel k_r;
+		Channel k_t;
+		Channel normal;
+		glm::vec3 eta = glm::vec3(1.f);
+		float n = 0.f;
+	};
+
+	void clear();
+
+	/*
+	 * compile the material and return its index in the table
+	 */
+	int add(Material const& material);
+
+	int size() const { return int(materials.size()); }
+
+	CompiledMaterial const& get(int idx) const;
+
+	/*
+	 * same as MaterialSample::evaluate for the compiled material idx
+	 */
+	void evaluate(int idx, Intersection const& isect, unsigned flags, MaterialSample* sample) const;
+
+private:
+	Channel compile_channel(std::shared_ptr<Texture> const& texture);
+	glm::vec3 evaluate_channel(Channel const& channel, Intersection const& isect) const;
+
+	std::vector<CompiledMaterial> materials;
+	std::vector<ImageTexture const*> images;
+	std::vector<Texture const*> generic_textures;
+	std::unordered_map<Texture const*, int32_t> texture_indices; // avoids duplicate entries for shared textures
+};
@@ -5,6 +5,7 @@
 #include <cglib/rt/ray.h>
 #include <cglib/rt/intersectable.h>
 #include <cglib/rt/intersection.h>
+#include <cglib/rt/hit_record.h>
 
 #ifndef _MSC_VER
 #include <mm_malloc.h>	// include for _mm_malloc()
@@ -18,7 +19,38 @@ public:
     Object();
     virtual ~Object() {}
 
-    virtual bool intersect(Ray const& ray, Intersection* isect) const;
+    /*
+     * Find the closest hit along the ray. Only the distance and the
+     * primitive are recorded, object_id is left to the caller.
+     */
+    virtual bool intersect(Ray const& ray, HitRecord* hit) const;
+
+    /*
+     * Same as intersect for two rays at once, e.g. the rays of both eyes
+     * in stereo mode. Bit i of the result is set if rays[i] hit.
+     */
+    virtual unsigned intersect_pair(Ray const rays[2], HitRecord hits[2]) const;
+
+    /*
+     * Any hit query for shadow rays: return true as soon as any hit closer
+     * than t_max is found, and record it in hit. Unlike intersect, the hit
+     * need not be the closest one.
+     */
+    virtual bool occluded(Ray const& ray, float t_max, HitRecord* hit) const;
+
+    /*
+     * Intersect the ray with the single primitive primitive_id, as recorded
+     * by a previous hit on this object. Objects consisting of one primitive
+     * ignore primitive_id.
+     */
+    virtual bool intersect_primitive(Ray const& ray, uint32_t primitive_id, HitRecord* hit) const;
+
+    /*
+     * Compute the full intersection for a hit found by intersect(ray, hit).
+     */
+    virtual void fill_intersection(Ray const& ray, HitRecord const& hit, Intersection* isect) const;
+
+    bool intersect(Ray const& ray, Intersection* isect) const;
 
     virtual void compute_shading_info(Intersection* isect);
 
@@ -33,6 +65,12 @@ public:
 
 	void set_transform_object_to_world(glm::mat4 const& T);
 
+	/*
+	 * evaluate the material at the intersection, using the compiled
+	 * material of the active scene if there is one.
+	 */
+	void evaluate_material(Intersection* isect) const;
+
 	void* operator new(std::size_t size){	/* ensure 16 byte memory alignment */
 		return _mm_malloc(size, 16);
 	}
@@ -43,6 +81,7 @@ public:
 
     std::shared_ptr<Intersectable> geo;
     std::shared_ptr<Material> material;
+    int material_index = -1; // index into the scene's material table, see Scene::compile_materials
     std::shared_ptr<TextureMapping> texture_mapping;
 	glm::mat4 transform_object_to_world        = glm::mat4(1.0f);
 	glm::mat4 transform_world_to_object        = glm::mat4(1.0f);
@@ -6,6 +6,7 @@
 #include <memory>
 
 class Scene;
+struct ShadingKernels;
 
 struct RaytracingContext
 {
@@ -15,6 +16,10 @@ struct RaytracingContext
 
     RaytracingParameters params;
 
+	// shading kernels for the feature toggles in params, selected by
+	// HostRender::launch. nullptr selects them on every call.
+	ShadingKernels const* shading_kernels = nullptr;
+
 	Scene *get_active_scene() const { return scenes[params.active_scene].get(); }
 	void add_scene(std::shared_ptr<Scene> scene);
 
@@ -34,6 +34,7 @@ class RaytracingParameters : public Parameters
 			DUDV,
 			BVH_TIME,
 			AABB_INTERSECT_COUNT,
+			SAMPLE_COUNT,
 			RENDER_MODE_COUNT
 		};
 
@@ -42,6 +43,7 @@ class RaytracingParameters : public Parameters
 			"du dv",
 			"BVH Traversal Time",
 			"AABB Intersection Count",
+			"Adaptive Sample Count",
 		};
 
 		enum Exercise {
@@ -82,6 +84,16 @@ class RaytracingParameters : public Parameters
 		};
 
 		int gauss_mode = GAUSS_INPUT;
+
+		enum LightSampling {
+			LIGHT_SAMPLING_ALL,
+			LIGHT_SAMPLING_BVH,
+			LIGHT_SAMPLING_COUNT
+		};
+
+		const char* light_sampling_names[LIGHT_SAMPLING_COUNT] = {
+			"All Lights", "Light BVH"
+		};
 		float sigma = 1.0f;
 		int kernel_radius = 3;
 
@@ -96,7 +108,20 @@ class RaytracingParameters : public Parameters
 		bool reflection         = true;
 		bool transmission       = true;
 		bool fresnel            = true;
+		// Follow either the reflected or the transmitted ray at dielectrics,
+		// chosen with probability F, instead of tracing both.
+		bool stochastic_fresnel = false;
 		bool dispersion         = false;
+		// Sample one hero wavelength per path instead of splitting
+		// dispersive rays into three rays (one per color channel).
+		bool spectral_dispersion = false;
+		// Recursive rays whose path throughput (product of k_r, k_t and
+		// fresnel weights) drops to min_throughput are not traced. With
+		// russian_roulette, rays at depth >= rr_min_depth are terminated
+		// randomly with probability 1 - throughput and reweighted otherwise.
+		bool russian_roulette   = false;
+		int rr_min_depth        = 2;
+		float min_throughput    = 0.f;
 		float scale_render_time = 10.0f;
 		float ray_epsilon       = 7.f*1e-3f;
 		float fovy              = 45.0f;
@@ -104,6 +129,13 @@ class RaytracingParameters : public Parameters
 		bool stratified = true;
 
 		bool normal_mapping = false;
+
+		// With LIGHT_SAMPLING_BVH, each shading point evaluates light_samples
+		// lights, sampled from Scene::light_bvh by their estimated
+		// contribution, instead of all lights.
+		int light_sampling = LIGHT_SAMPLING_ALL;
+		int light_samples  = 4;
+
 		bool transform_objects = true;
 		int spp = 1; // number of samples per pixel
 
@@ -112,6 +144,23 @@ class RaytracingParameters : public Parameters
 		int tex_filter_mode = TextureFilterMode::TRILINEAR;
 		int tex_wrap_mode = TextureWrapMode::REPEAT;
 
+		// Interactive mode only: render one sample per pass and accumulate
+		// while nothing that affects the image changes.
+		bool progressive = false;
+		int max_progressive_passes = 1024;
+
+		// Adaptive sampling: after adaptive_min_spp samples, only pixels whose
+		// relative error exceeds adaptive_threshold are sampled further, until
+		// adaptive_budget_spp samples per pixel are spent on average.
+		// Renders in passes like progressive mode.
+		bool adaptive_sampling = false;
+		int adaptive_min_spp = 4;
+		int adaptive_max_spp = 256;
+		int adaptive_budget_spp = 16;
+		float adaptive_threshold = 0.02f;
+
+	protected:
+		bool derived_change_requires_restart(Parameters const& old) const override;
 
 	private:
 };
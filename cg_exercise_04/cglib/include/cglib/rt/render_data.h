@@ -6,6 +6,17 @@
 struct ThreadLocalData;
 struct RaytracingContext;
 
+/*
+ * The right eye of a stereo pixel. While the left eye is rendered, each of
+ * its samples also traces the right eye through the same sample position,
+ * pairing the primary rays of both eyes (see Object::intersect_pair).
+ */
+struct StereoPair
+{
+	glm::vec3 right = glm::vec3(0.f); // summed color of the right eye samples
+	int num_samples = 0;              // number of right eye samples
+};
+
 /*
  * Rendering data that will be passed to the raytracer for each pixel
  */
@@ -25,4 +36,8 @@ struct RenderData
 	float x = 0.0f;	// x-Coordinate of (Sub-)Pixel
 	float y = 0.0f;	// y-Coordinate of (Sub-)Pixel
 	Camera::Mode camera_mode = Camera::Mono;
+	int progressive_pass = -1; // index of the progressive pass, -1 if all samples are rendered at once
+	float wavelength = 0.f;          // hero wavelength of the current path in nm, 0 if not sampled yet
+	float wavelength_sample = -1.f;  // random number in [0, 1) for the hero wavelength, negative to draw a new one
+	StereoPair* stereo = nullptr;    // set while rendering a stereo pixel
 };
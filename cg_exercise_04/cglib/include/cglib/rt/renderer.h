@@ -8,6 +8,7 @@ struct RenderData;
 class Intersection;
 struct ThreadLocalData;
 class MaterialSample;
+class RaytracingParameters;
 
 /*
  * reflect the vector v at the normal vector n. v points "away from n"
@@ -42,12 +43,15 @@ Ray createPrimaryRay(
 	float x, float y);
 
 /*
- * check if a point "to" is visible from the point "from"
+ * check if a point "to" is visible from the point "from".
+ * If "to" is the position of light number light, the occluder cache of
+ * the thread is tested first (see ShadowCache).
  */
 bool visible(
 	RenderData &data,
 	glm::vec3 const& from,
-	glm::vec3 const& to);
+	glm::vec3 const& to,
+	int light = -1);
 
 /*
  * Shoot a ray and return intersection information
@@ -107,7 +111,8 @@ glm::vec3 evaluate_reflection(
 	int depth,					// the current recursion depth
 	glm::vec3 const& P,			// world space position
 	glm::vec3 const& N,			// normal at the position (already normalized)
-	glm::vec3 const& V);		// view vector (already normalized)
+	glm::vec3 const& V,			// view vector (already normalized)
+	glm::vec3 const& throughput = glm::vec3(1.f));	// path throughput of the reflected ray
 
 glm::vec3 evaluate_transmission(
 	RenderData &data,			// class containing raytracing information
@@ -115,7 +120,8 @@ glm::vec3 evaluate_transmission(
 	glm::vec3 const& P,			// world space position
 	glm::vec3 const& N,			// normal at the position (already normalized)
 	glm::vec3 const& V,			// view vector (already normalized)
-	float eta);					// the relative refraction index
+	float eta,					// the relative refraction index
+	glm::vec3 const& throughput = glm::vec3(1.f));	// path throughput of the transmitted ray
 
 glm::vec3 handle_transmissive_material_single_ior(
 	RenderData &data,			// class containing raytracing information
@@ -123,7 +129,22 @@ glm::vec3 handle_transmissive_material_single_ior(
 	glm::vec3 const& P,			// world space position
 	glm::vec3 const& N,			// normal at the position (already normalized)
 	glm::vec3 const& V,			// view vector (already normalized)
-	float eta);					// the relative refraction index
+	float eta,					// the relative refraction index
+	glm::vec3 const& throughput = glm::vec3(1.f));	// path throughput up to P, excluding fresnel
+
+/*
+ * Dispersion using a single hero wavelength per path. The first dispersive hit
+ * samples the wavelength, weights the result with its RGB response and stores
+ * it in data.wavelength, so that deeper dispersive hits use the same wavelength.
+ */
+glm::vec3 handle_transmissive_material_spectral(
+	RenderData &data,					// class containing raytracing information
+	int depth,							// the current recursion depth
+	glm::vec3 const& P,					// world space position
+	glm::vec3 const& N,					// normal at the position (already normalized)
+	glm::vec3 const& V,					// view vector (already normalized)
+	glm::vec3 const& eta_of_channel,	// relative refraction index of red, green and blue color channel
+	glm::vec3 const& throughput = glm::vec3(1.f));	// path throughput up to P, excluding fresnel
 
 glm::vec3 handle_transmissive_material(
 	RenderData &data,					// class containing raytracing information
@@ -131,13 +152,50 @@ glm::vec3 handle_transmissive_material(
 	glm::vec3 const& P,					// world space position
 	glm::vec3 const& N,					// normal at the position (already normalized)
 	glm::vec3 const& V,					// view vector (already normalized)
-	glm::vec3 const& eta_of_channel);	// relative refraction index of red, green and blue color channel
+	glm::vec3 const& eta_of_channel,	// relative refraction index of red, green and blue color channel
+	glm::vec3 const& throughput = glm::vec3(1.f));	// path throughput up to P, excluding dispersion and fresnel
 
 /*
  * Call this function to start or continue one path segment during recursive raytracing
+ *
+ * throughput is the factor the returned radiance will be scaled with on its way
+ * to the camera. It is used to terminate paths early (see min_throughput and
+ * russian_roulette in RaytracingParameters).
  */
 glm::vec3 trace_recursive(
 	RenderData & data,
 	Ray const& ray,
-	int depth);
+	int depth,
+	glm::vec3 const& throughput = glm::vec3(1.f));
+
+/*
+ * The shading functions above, specialized for one combination of the
+ * feature toggles shadows, ambient, diffuse and specular. Disabled features
+ * are compiled away, so the kernels do not test them per light. The other
+ * toggles are tested once per hit.
+ *
+ * The free functions above forward to the kernels of the active context,
+ * which HostRender::launch selects once per launch.
+ */
+struct ShadingKernels
+{
+	glm::vec3 (*evaluate_phong)(RenderData&, MaterialSample const&,
+		glm::vec3 const&, glm::vec3 const&, glm::vec3 const&);
+	glm::vec3 (*evaluate_reflection)(RenderData&, int,
+		glm::vec3 const&, glm::vec3 const&, glm::vec3 const&, glm::vec3 const&);
+	glm::vec3 (*evaluate_transmission)(RenderData&, int,
+		glm::vec3 const&, glm::vec3 const&, glm::vec3 const&, float, glm::vec3 const&);
+	glm::vec3 (*handle_transmissive_material_single_ior)(RenderData&, int,
+		glm::vec3 const&, glm::vec3 const&, glm::vec3 const&, float, glm::vec3 const&);
+	glm::vec3 (*handle_transmissive_material_spectral)(RenderData&, int,
+		glm::vec3 const&, glm::vec3 const&, glm::vec3 const&, glm::vec3 const&, glm::vec3 const&);
+	glm::vec3 (*handle_transmissive_material)(RenderData&, int,
+		glm::vec3 const&, glm::vec3 const&, glm::vec3 const&, glm::vec3 const&, glm::vec3 const&);
+	glm::vec3 (*trace_recursive)(RenderData&, Ray const&, int, glm::vec3 const&);
+};
+
+/*
+ * return the kernels for the feature toggles in params
+ */
+ShadingKernels const& select_shading_kernels(RaytracingParameters const& params);
 
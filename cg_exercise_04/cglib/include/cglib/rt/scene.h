@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cglib/rt/texture.h>
+#include <cglib/rt/material_table.h>
+#include <cglib/rt/light_bvh.h>
 
 #include <vector>
 #include <memory>
@@ -33,6 +35,8 @@ public:
 	TextureContainer textures;
 	ImageTexture* env_map = nullptr;
 	std::vector<std::shared_ptr<TriangleSoup>> soups;
+	MaterialTable material_table;
+	LightBVH light_bvh;
 
     virtual ~Scene();
 
@@ -41,6 +45,29 @@ public:
 	virtual void init_camera(RaytracingParameters& params) {}
 	virtual void set_active_camera();
 
+	/*
+	 * Compile the materials of all objects and triangle soups into
+	 * material_table. Has to be called after the scene has been (re)built.
+	 */
+	void compile_materials();
+
+	/*
+	 * Build light_bvh for lights. Has to be called after the scene has been (re)built.
+	 */
+	void build_light_bvh();
+
+	/*
+	 * Block compress the textures (see ImageTexture::compress) and print
+	 * the size and quality of each texture.
+	 */
+	void compress_textures();
+
+	/*
+	 * Texture that is displayed instead of raytracing the scene,
+	 * nullptr for regular scenes.
+	 */
+	virtual ImageTexture const* get_display_texture(RaytracingParameters const& params) const { return nullptr; }
+
 	virtual const char *get_name() { return "unknown"; }
 };
 
@@ -109,6 +136,7 @@ public:
 	void init_scene(RaytracingParameters const& params);
     void refresh_scene(RaytracingParameters const& params);
 	void create_texture_quad(std::shared_ptr<ImageTexture> const& texture);
+	ImageTexture const* get_display_texture(RaytracingParameters const& params) const override;
 };
 
 class GaussScene : public Scene
@@ -120,6 +148,7 @@ public:
 	void init_scene(RaytracingParameters const& params);
     void refresh_scene(RaytracingParameters const& params);
 	void create_texture_quad(std::shared_ptr<ImageTexture> const& texture);
+	ImageTexture const* get_display_texture(RaytracingParameters const& params) const override;
 };
 
 class MonkeyScene : public Scene
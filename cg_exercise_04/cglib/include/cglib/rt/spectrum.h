@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+/*
+ * Helpers for spectral (hero wavelength) rendering of dispersion.
+ *
+ * Wavelengths are given in nanometers and sampled uniformly from
+ * [SPECTRUM_MIN_WAVELENGTH, SPECTRUM_MAX_WAVELENGTH].
+ */
+#define SPECTRUM_MIN_WAVELENGTH (380.f)
+#define SPECTRUM_MAX_WAVELENGTH (780.f)
+
+/*
+ * map a uniform random number u in [0, 1) to a wavelength.
+ */
+float sample_wavelength(float u);
+
+/*
+ * linear sRGB weight of a single wavelength sample, divided by its pdf.
+ * The weights are normalized such that their expected value is (1, 1, 1),
+ * i.e. averaging over many wavelengths reproduces white.
+ */
+glm::vec3 wavelength_to_rgb_weight(float wavelength);
+
+/*
+ * index of refraction at the given wavelength. A Cauchy model
+ * eta(lambda) = A + B / lambda^2 is fitted to the refraction indices
+ * of the red, green and blue channel.
+ */
+float dispersion_ior(glm::vec3 const& eta_of_channel, float wavelength);
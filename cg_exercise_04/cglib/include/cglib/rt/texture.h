@@ -9,6 +9,9 @@
 #include <unordered_map>
 #include <string>
 
+#include <cglib/core/simd.h>
+#include <cglib/core/tiled_image.h>
+
 class Image;
 
 enum TextureFilterMode {
@@ -31,11 +34,54 @@ enum TextureWrapMode {
 
 extern const char* tex_wrap_mode_names[TEXTURE_WRAP_MODE_COUNT];
 
+/*
+ * Filter used to downsample one mip level to the next. BOX averages 2x2
+ * texels (3 along odd sizes). KAISER (Kaiser windowed sinc) and LANCZOS
+ * (Lanczos 3) are separable filters that keep more detail in the coarser
+ * levels. They cover 3 texels of the coarser level on each side, i.e.
+ * 2 * ceil(3 * size / (size / 2)) + 1 taps per direction: 13 for even
+ * sizes, up to 19 for odd ones.
+ */
+enum MipmapFilter {
+	MIPMAP_FILTER_BOX,
+	MIPMAP_FILTER_KAISER,
+	MIPMAP_FILTER_LANCZOS,
+	MIPMAP_FILTER_COUNT
+};
+
+extern const char* mipmap_filter_names[MIPMAP_FILTER_COUNT];
+
+/*
+ * Memory layout of the texels of an ImageTexture, see TiledImage.
+ */
+enum TextureLayout {
+	TEXTURE_LAYOUT_LINEAR,
+	TEXTURE_LAYOUT_TILED,
+	TEXTURE_LAYOUT_COUNT
+};
+
+/*
+ * Result of ImageTexture::compress.
+ */
+struct TextureCompressionReport
+{
+	TiledImage::Format format;
+	int width, height;           // of level 0
+	std::size_t size_before = 0; // memory_size() before and after compression
+	std::size_t size_after = 0;
+	double psnr = 0.0;           // of level 0, see TiledImage::psnr
+};
+
 class Texture
 { 
 public:
 	virtual ~Texture() {}
 	virtual glm::vec4 evaluate(glm::vec2 const& uv, glm::vec2 const& dudv = glm::vec2(0.f)) const = 0;
+
+	/*
+	 * returns true and the value if the texture does not depend on uv.
+	 */
+	virtual bool is_constant(glm::vec4* /*value*/) const { return false; }
 };
 
 class ConstTexture : public Texture
@@ -51,13 +97,28 @@ public:
         return glm::vec4(value, 0.0f);
     }
 
+	bool is_constant(glm::vec4* value_) const override
+	{
+		*value_ = glm::vec4(value, 0.0f);
+		return true;
+	}
+
 private:
     glm::vec3 value = glm::vec3(0.0f);
 };
 
-class ImageTexture : public Texture
+class ImageTexture final : public Texture
 {
 public:
+	/*
+	 * The texel format of the mip levels is chosen from the file:
+	 * RGBA8 for 8 bit images, half floats for HDR images.
+	 *
+	 * If the TextureCache is enabled, the levels are taken from the cache
+	 * when possible instead of decoding the file (see create_mipmap). With
+	 * the PageCache enabled, cached texels are only read when they are
+	 * first accessed.
+	 */
     ImageTexture(
         std::string const& filename,
         TextureFilterMode filter_mode,
@@ -69,6 +130,14 @@ public:
         TextureWrapMode wrap_mode);
 
 	glm::vec4 evaluate(glm::vec2 const& uv, glm::vec2 const& dudv) const override;
+
+	/*
+	 * out[i] = textures[i]->evaluate(uv, dudv) for count textures, e.g. the
+	 * channels of a material. The coordinates and weights of the bilinear
+	 * lookups of the batch are computed four at a time.
+	 */
+	static void evaluate(int count, ImageTexture const* const textures[],
+		glm::vec2 const& uv, glm::vec2 const& dudv, glm::vec4 out[]);
     glm::vec4 evaluate_nearest(int level, glm::vec2 const& uv) const;
     glm::vec4 evaluate_bilinear(int level, glm::vec2 const& uv) const;
     glm::vec4 evaluate_trilinear(glm::vec2 const& uv, glm::vec2 const& dudv) const;
@@ -78,16 +147,118 @@ public:
 	glm::vec4 get_texel(int level, int x, int y) const;
 	void set_texel(int level, int x, int y, glm::vec4 const& val);
 
+	/*
+	 * The linear mip levels. Empty while the texture is stored in tiled
+	 * levels, i.e. after create_mipmap with TEXTURE_LAYOUT_TILED.
+	 */
 	std::vector<std::shared_ptr<Image>> const& get_mip_levels() const {
 		return mip_levels;
 	}
 
-	void create_mipmap();
+	/*
+	 * Build the mip levels. Each level has half the size of the previous
+	 * one, rounded down, so sizes need not be powers of two. With
+	 * TEXTURE_LAYOUT_TILED, they are converted to tiled levels in the
+	 * texel format of the texture, which replace the linear ones.
+	 *
+	 * The rows of each level are computed in parallel on num_threads
+	 * threads (all hardware threads if num_threads <= 0).
+	 *
+	 * Levels of textures loaded from files are stored in the TextureCache,
+	 * and do nothing if the levels were loaded from it with the same filter.
+	 * With the PageCache enabled, the levels are paged from the new entry
+	 * afterwards.
+	 */
+	void create_mipmap(MipmapFilter filter = MIPMAP_FILTER_BOX, int num_threads = 0);
+
+	/*
+	 * Load the files and create the mipmaps of the textures concurrently,
+	 * one texture per thread.
+	 */
+	static std::vector<std::shared_ptr<ImageTexture>> load_mipmapped(
+		std::vector<std::string> const& filenames,
+		TextureFilterMode filter_mode,
+		TextureWrapMode wrap_mode,
+		MipmapFilter filter = MIPMAP_FILTER_BOX);
+
+	/*
+	 * Switch the layout get_texel reads from, converting the levels.
+	 */
+	void set_layout(TextureLayout layout);
+	TextureLayout get_layout() const { return layout; }
+
+	TiledImage::Format get_format() const { return format; }
+
+	/*
+	 * The modes select the specialized lookups, so they can only be
+	 * changed through these.
+	 */
+	void set_filter_mode(TextureFilterMode filter_mode);
+	void set_wrap_mode(TextureWrapMode wrap_mode);
+	TextureFilterMode get_filter_mode() const { return filter_mode; }
+	TextureWrapMode get_wrap_mode() const { return wrap_mode; }
+
+	/*
+	 * Block compress the levels of an RGBA8 texture: BC3 if it has
+	 * transparent texels, BC1 otherwise. Textures in other formats or
+	 * with TEXTURE_LAYOUT_LINEAR are not changed, and false is returned.
+	 * Compressed mip levels are stored in and loaded from the TextureCache.
+	 */
+	bool compress(TextureCompressionReport* report = nullptr);
+
+	/*
+	 * memory used by the texels of all levels in bytes
+	 */
+	std::size_t memory_size() const;
+
+private:
+	/*
+	 * The lookups behind evaluate_nearest, evaluate_bilinear and
+	 * evaluate_trilinear, specialized on the wrap mode (see texture.cpp).
+	 * They do not test the filter mode or wrap mode per texel.
+	 */
+	template <class Wrap> glm::vec4 nearest(int level, glm::vec2 const& uv) const;
+	template <class Wrap> glm::vec4 bilinear(int level, glm::vec2 const& uv) const;
+	template <class Wrap> float4 bilinear(int level, float ffs, float fft, float ws, float wt) const;
+	template <class Wrap> glm::vec4 trilinear(glm::vec2 const& uv, glm::vec2 const& dudv) const;
+	glm::vec4 level_constant(int level, glm::vec2 const& uv) const;
+	glm::vec4 trilinear_constant(glm::vec2 const& uv, glm::vec2 const& dudv) const;
+	void trilinear_levels(glm::vec2 const& dudv, int* lower, int* upper, float* alpha) const;
+	void gather(int level, int x0, int x1, int y0, int y1, glm::vec4 out[4]) const;
+
+	/*
+	 * Select the lookups for the filter mode, the wrap mode and the size
+	 * of level 0. The size is fixed once the texture is constructed,
+	 * the modes change through set_filter_mode and set_wrap_mode.
+	 */
+	void select_lookups();
+	template <class Wrap> void select_wrap_lookups();
 
 	TextureFilterMode filter_mode;
 	TextureWrapMode wrap_mode;
-private:
+	bool power_of_two = false; // width and height of level 0 are powers of two
+	glm::vec4 (ImageTexture::*nearest_lookup)(int, glm::vec2 const&) const = nullptr;
+	glm::vec4 (ImageTexture::*bilinear_lookup)(int, glm::vec2 const&) const = nullptr;
+	float4 (ImageTexture::*bilinear_tap_lookup)(int, float, float, float, float) const = nullptr;
+	glm::vec4 (ImageTexture::*trilinear_lookup)(glm::vec2 const&, glm::vec2 const&) const = nullptr;
+
+	void build_tiled_levels();
+	std::string cache_key(MipmapFilter filter, TiledImage::Format format) const;
+	bool load_cached(MipmapFilter filter, TiledImage::Format format, double* psnr = nullptr);
+	int num_levels() const;
+	int level_width(int level) const;
+	int level_height(int level) const;
+
+	TextureLayout layout = TEXTURE_LAYOUT_TILED;
+	TiledImage::Format format = TiledImage::RGBA32F; // format of the tiled levels
+	float gamma = 1.f;                               // gamma of RGBA8 texels
 	std::vector<std::shared_ptr<Image>> mip_levels; // the different mip map textures
+	std::vector<TiledImage> tiled_levels;         // tiled copies of mip_levels, empty before create_mipmap
+
+	std::string source;                              // file the texture was loaded from, if any
+	MipmapFilter mipmap_filter = MIPMAP_FILTER_BOX;  // filter of the mipmapped tiled levels
+	bool mipmapped = false;                          // tiled_levels hold a mip chain
+	bool cached = false;                             // tiled_levels were loaded from the TextureCache
 };
 
 typedef std::unordered_map<std::string, std::shared_ptr<ImageTexture>> TextureContainer;
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cglib/core/tiled_image.h>
+
+#include <string>
+#include <vector>
+
+/*
+ * On-disk cache of the tiled levels of textures loaded from files.
+ *
+ * Each entry is one file in the cache directory that holds the levels in
+ * their runtime format and layout. Entries are identified by a key built
+ * from the path, modification time and size of the source file and the
+ * parameters the levels were computed with. Loading an entry maps the file
+ * into memory, the levels use the mapped pixels directly. If the PageCache
+ * is enabled, only the headers are read and the levels load their pixels
+ * page by page on access instead.
+ */
+class TextureCache
+{
+public:
+	/*
+	 * Directory of the cache files. Empty (the default) disables the cache.
+	 */
+	static void set_directory(std::string const& directory);
+	static std::string const& get_directory();
+	static bool enabled() { return !get_directory().empty(); }
+
+	/*
+	 * Key of the levels computed from the file source with the given
+	 * parameters. Empty if source can not be found.
+	 */
+	static std::string key(std::string const& source, std::string const& parameters);
+
+	/*
+	 * Load the levels of the entry for key. Returns false if there is no
+	 * valid entry.
+	 */
+	static bool load(std::string const& key, std::vector<TiledImage>* levels, double* psnr = nullptr);
+
+	/*
+	 * Create or replace the entry for key. psnr is stored along with the
+	 * levels, see TextureCompressionReport.
+	 */
+	static void store(std::string const& key, std::vector<TiledImage> const& levels, double psnr = 0.0);
+};
@@ -20,6 +20,7 @@ public:
     std::vector<int> material_ids;
     std::vector<Material> materials;
 	int num_triangles = 0;
+	int material_table_offset = -1; // index of materials[0] in the scene's material table, -1 if not compiled
 
 	TriangleSoup();
 
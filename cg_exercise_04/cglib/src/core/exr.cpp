@@ -0,0 +1,125 @@
+#include <cglib/core/exr.h>
+#include <cglib/core/image.h>
+#include <cglib/core/assert.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+/*
+ * OpenEXR is little endian, as are all platforms we build for.
+ */
+template <class T>
+static void write_value(std::vector<char>* out, T const& value)
+{
+	char const* bytes = reinterpret_cast<char const*>(&value);
+	out->insert(out->end(), bytes, bytes + sizeof(T));
+}
+
+static void write_string(std::vector<char>* out, std::string const& s)
+{
+	out->insert(out->end(), s.begin(), s.end());
+	out->push_back('\0');
+}
+
+static void write_attribute_header(std::vector<char>* out,
+	std::string const& name, std::string const& type, std::int32_t size)
+{
+	write_string(out, name);
+	write_string(out, type);
+	write_value(out, size);
+}
+
+bool save_exr(std::string const& path, std::vector<ExrChannel> channels)
+{
+	cg_assert(!channels.empty());
+	const int width  = channels[0].image->getWidth();
+	const int height = channels[0].image->getHeight();
+	for (auto const& c : channels) {
+		cg_assert(c.image->getWidth() == width && c.image->getHeight() == height);
+		cg_assert(c.component >= 0 && c.component < 4);
+	}
+
+	// readers expect the channels in alphabetical order
+	std::sort(channels.begin(), channels.end(),
+		[](ExrChannel const& a, ExrChannel const& b) { return a.name < b.name; });
+
+	std::vector<char> header;
+	write_value(&header, std::uint32_t(20000630)); // magic number
+	write_value(&header, std::uint32_t(2));        // version 2, single part scanline file
+
+	std::int32_t chlist_size = 1;
+	for (auto const& c : channels)
+		chlist_size += std::int32_t(c.name.size()) + 1 + 16;
+	write_attribute_header(&header, "channels", "chlist", chlist_size);
+	for (auto const& c : channels) {
+		write_string(&header, c.name);
+		write_value(&header, std::int32_t(2)); // FLOAT
+		write_value(&header, std::uint32_t(0)); // pLinear and reserved
+		write_value(&header, std::int32_t(1)); // x sampling
+		write_value(&header, std::int32_t(1)); // y sampling
+	}
+	header.push_back('\0');
+
+	write_attribute_header(&header, "compression", "compression", 1);
+	header.push_back(0); // NO_COMPRESSION
+
+	for (const char* window : { "dataWindow", "displayWindow" }) {
+		write_attribute_header(&header, window, "box2i", 16);
+		write_value(&header, std::int32_t(0));
+		write_value(&header, std::int32_t(0));
+		write_value(&header, std::int32_t(width - 1));
+		write_value(&header, std::int32_t(height - 1));
+	}
+
+	write_attribute_header(&header, "lineOrder", "lineOrder", 1);
+	header.push_back(0); // INCREASING_Y
+
+	write_attribute_header(&header, "pixelAspectRatio", "float", 4);
+	write_value(&header, 1.f);
+
+	write_attribute_header(&header, "screenWindowCenter", "v2f", 8);
+	write_value(&header, 0.f);
+	write_value(&header, 0.f);
+
+	write_attribute_header(&header, "screenWindowWidth", "float", 4);
+	write_value(&header, 1.f);
+
+	header.push_back('\0');
+
+	// one scanline per block, preceded by the table of block offsets
+	const std::int32_t line_size = std::int32_t(channels.size() * width * sizeof(float));
+	const std::uint64_t first_block = header.size() + height * sizeof(std::uint64_t);
+	for (int y = 0; y < height; ++y) {
+		write_value(&header, first_block + std::uint64_t(y) * (2 * sizeof(std::int32_t) + line_size));
+	}
+
+	std::ofstream of(path.c_str(), std::ios::out | std::ios::binary);
+	if (!of) {
+		std::cerr << "Cannot open " << path << " for writing." << std::endl;
+		return false;
+	}
+	of.write(header.data(), std::streamsize(header.size()));
+
+	std::vector<float> line(width);
+	for (int y = 0; y < height; ++y) {
+		const std::int32_t block[2] = { y, line_size };
+		of.write(reinterpret_cast<char const*>(block), sizeof(block));
+		// exr stores the top row first, images store the bottom row first
+		const int row = height - 1 - y;
+		for (auto const& c : channels) {
+			glm::vec4 const* pixels = c.image->getPixels() + row * width;
+			for (int x = 0; x < width; ++x)
+				line[x] = pixels[x][c.component];
+			of.write(reinterpret_cast<char const*>(line.data()), std::streamsize(width * sizeof(float)));
+		}
+	}
+
+	if (!of) {
+		std::cerr << "An error occured while writing " << path << std::endl;
+		return false;
+	}
+	return true;
+}
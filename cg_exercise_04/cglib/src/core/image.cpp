@@ -104,31 +104,64 @@ void Image::save(std::string const& path, float gamma) const
 void Image::load(std::string const& path, float gamma)
 {
 	int num_components;
-	stbi_ldr_to_hdr_gamma(gamma);
-    float *data = stbi_loadf(path.c_str(), &m_width, &m_height, &num_components, 4);
+	if (stbi_is_hdr(path.c_str())) {
+		float *data = stbi_loadf(path.c_str(), &m_width, &m_height, &num_components, 4);
+		if(!data) {
+			std::cerr << "error: could not load image \"" << path << "\"" << std::endl;
+			m_width = m_height = 1;
+			m_pixels.resize(1);
+			return;
+		}
+		m_pixels.resize(m_width * m_height);
+		/* flip image in Y */
+		for(int y = 0; y < m_height; y++) {
+			memcpy(&m_pixels[(m_height - y - 1) * m_width],
+					data + y * m_width * 4,
+					4 * m_width * sizeof(float));
+		}
+		stbi_image_free(data);
+		return;
+	}
+
+	/*
+	 * 8 bit images are decoded here instead of with stbi_loadf, which
+	 * takes the gamma from a global setting and is thus not safe to call
+	 * from several threads. The conversion is the same: color is decoded
+	 * with gamma, alpha is linear.
+	 */
+	unsigned char *data = stbi_load(path.c_str(), &m_width, &m_height, &num_components, 4);
 	if(!data) {
 		std::cerr << "error: could not load image \"" << path << "\"" << std::endl;
-    m_width = m_height = 1;
-    m_pixels.resize(1);
+		m_width = m_height = 1;
+		m_pixels.resize(1);
 		return;
 	}
+	float lut[256];
+	for (int i = 0; i < 256; ++i)
+		lut[i] = float(std::pow(double(float(i) / 255.0f), double(gamma)));
 	m_pixels.resize(m_width * m_height);
 	/* flip image in Y */
 	for(int y = 0; y < m_height; y++) {
-		memcpy(&m_pixels[(m_height - y - 1) * m_width],
-				data + y * m_width * 4,
-				4 * m_width * sizeof(float));
+		unsigned char const* src = data + y * m_width * 4;
+		glm::vec4* dst = &m_pixels[(m_height - y - 1) * m_width];
+		for (int x = 0; x < m_width; ++x, src += 4)
+			dst[x] = glm::vec4(lut[src[0]], lut[src[1]], lut[src[2]], float(src[3]) / 255.0f);
 	}
 	stbi_image_free(data);
 }
 
-void Image::save_pfm(std::string const& path) const
+bool Image::is_hdr(std::string const& path)
+{
+	return stbi_is_hdr(path.c_str()) != 0;
+}
+
+bool Image::save_pfm(std::string const& path) const
 {
 	std::ofstream of(path.c_str(), std::ios::out | std::ios::binary);
 
 	if (!of) {
 		std::cerr << "Cannot open " << path << " for writing." << std::endl;
-		return;
+		return false;
 	}
 
 	// write header.
@@ -145,9 +178,11 @@ void Image::save_pfm(std::string const& path) const
 
 	if (!of) {
 		std::cerr << "An error occured while writing " << path << std::endl;
+		return false;
 	}
 
 	of.close();
+	return true;
 }
 	
 static void readCommentsAndEmptyLines(std::ifstream& file)
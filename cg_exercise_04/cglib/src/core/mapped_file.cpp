@@ -0,0 +1,53 @@
+#include <cglib/core/mapped_file.h>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::shared_ptr<MappedFile> MappedFile::
+open(std::string const& path)
+{
+	std::shared_ptr<MappedFile> file(new MappedFile());
+#ifdef _WIN32
+	std::ifstream in(path.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+	if (!in)
+		return nullptr;
+	file->m_buffer.resize(std::size_t(in.tellg()));
+	in.seekg(0);
+	if (file->m_buffer.empty() || !in.read(file->m_buffer.data(), std::streamsize(file->m_buffer.size())))
+		return nullptr;
+	file->m_data = file->m_buffer.data();
+	file->m_size = file->m_buffer.size();
+#else
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return nullptr;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		close(fd);
+		return nullptr;
+	}
+	void* data = mmap(nullptr, std::size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping stays valid after closing the file
+	close(fd);
+	if (data == MAP_FAILED)
+		return nullptr;
+	file->m_data = data;
+	file->m_size = std::size_t(st.st_size);
+#endif
+	return file;
+}
+
+MappedFile::
+~MappedFile()
+{
+#ifndef _WIN32
+	if (m_data)
+		munmap(const_cast<void*>(m_data), m_size);
+#endif
+}
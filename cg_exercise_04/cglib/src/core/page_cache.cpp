@@ -0,0 +1,220 @@
+#include <cglib/core/page_cache.h>
+
+#include <cglib/core/assert.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct Page
+{
+	std::uint64_t key;
+	std::vector<std::uint64_t> data; // PAGE_SIZE bytes, 8 byte aligned
+};
+
+std::uint64_t page_key(std::uint64_t file_id, std::size_t page)
+{
+	// files larger than 2^40 pages are not supported
+	return (file_id << 40) | std::uint64_t(page);
+}
+
+/*
+ * The pages in least recently used order (front is the most recent).
+ */
+struct Cache
+{
+	std::mutex mutex;
+	std::list<std::shared_ptr<Page const>> lru;
+	std::unordered_map<std::uint64_t, std::list<std::shared_ptr<Page const>>::iterator> pages;
+	std::size_t budget = 0;
+	PageCache::Stats stats;
+
+	void evict(std::size_t budget_)
+	{
+		while (!lru.empty() && stats.resident_bytes > budget_) {
+			pages.erase(lru.back()->key);
+			lru.pop_back();
+			stats.resident_bytes -= PageCache::PAGE_SIZE;
+			stats.evictions++;
+		}
+	}
+};
+
+Cache& cache()
+{
+	static Cache c;
+	return c;
+}
+
+std::atomic<std::uint64_t> next_file_id(1);
+
+/*
+ * The pages each thread holds on to, direct mapped by page key.
+ */
+struct ThreadSlot
+{
+	std::uint64_t key = 0;
+	std::shared_ptr<Page const> page;
+};
+
+thread_local ThreadSlot thread_slots[PageCache::THREAD_PAGES];
+
+} // namespace
+
+std::shared_ptr<PageCache::File> PageCache::
+open(std::string const& path)
+{
+	std::shared_ptr<File> file(new File());
+#ifdef _WIN32
+	std::ifstream in(path.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+	if (!in)
+		return nullptr;
+	file->m_size = std::size_t(in.tellg());
+#else
+	file->m_fd = ::open(path.c_str(), O_RDONLY);
+	struct stat st;
+	if (file->m_fd < 0 || fstat(file->m_fd, &st) != 0)
+		return nullptr;
+	file->m_size = std::size_t(st.st_size);
+#endif
+	file->m_path = path;
+	file->m_id = next_file_id++;
+	return file;
+}
+
+PageCache::File::
+~File()
+{
+#ifndef _WIN32
+	if (m_fd >= 0)
+		close(m_fd);
+#endif
+	// the pages can not be fetched anymore
+	Cache& c = cache();
+	std::lock_guard<std::mutex> lock(c.mutex);
+	for (auto it = c.lru.begin(); it != c.lru.end();) {
+		if (((*it)->key >> 40) == m_id) {
+			c.pages.erase((*it)->key);
+			it = c.lru.erase(it);
+			c.stats.resident_bytes -= PAGE_SIZE;
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+bool PageCache::File::
+read(std::size_t offset, std::size_t size, void* dst) const
+{
+#ifdef _WIN32
+	std::ifstream in(m_path.c_str(), std::ios::in | std::ios::binary);
+	in.seekg(std::streamoff(offset));
+	return bool(in.read(static_cast<char*>(dst), std::streamsize(size)));
+#else
+	char* p = static_cast<char*>(dst);
+	while (size > 0) {
+		const ssize_t n = pread(m_fd, p, size, off_t(offset));
+		if (n <= 0)
+			return false;
+		p += n;
+		offset += std::size_t(n);
+		size -= std::size_t(n);
+	}
+	return true;
+#endif
+}
+
+void PageCache::
+set_budget(std::size_t bytes)
+{
+	Cache& c = cache();
+	std::lock_guard<std::mutex> lock(c.mutex);
+	c.budget = bytes;
+	c.evict(bytes);
+}
+
+std::size_t PageCache::
+get_budget()
+{
+	return cache().budget;
+}
+
+void const* PageCache::
+fetch(File const& file, std::size_t offset)
+{
+	const std::size_t page = offset / PAGE_SIZE;
+	const std::uint64_t key = page_key(file.m_id, page);
+	ThreadSlot& slot = thread_slots[(key ^ (key >> 40) * 7) % THREAD_PAGES];
+	if (slot.key != key || !slot.page) {
+		Cache& c = cache();
+		std::unique_lock<std::mutex> lock(c.mutex);
+		auto it = c.pages.find(key);
+		if (it != c.pages.end()) {
+			c.lru.splice(c.lru.begin(), c.lru, it->second);
+			c.stats.hits++;
+			slot.page = *it->second;
+		}
+		else {
+			// read without holding the lock, another thread may load the
+			// same page meanwhile
+			lock.unlock();
+			std::shared_ptr<Page> loaded(new Page());
+			loaded->key = key;
+			loaded->data.resize(PAGE_SIZE / sizeof(std::uint64_t));
+			const std::size_t begin = page * PAGE_SIZE;
+			const std::size_t size = std::min(PAGE_SIZE, file.size() > begin ? file.size() - begin : 0);
+			if (!file.read(begin, size, loaded->data.data()))
+				std::memset(loaded->data.data(), 0, size);
+			lock.lock();
+
+			it = c.pages.find(key);
+			if (it != c.pages.end()) {
+				slot.page = *it->second;
+			}
+			else {
+				c.lru.push_front(loaded);
+				c.pages[key] = c.lru.begin();
+				c.stats.resident_bytes += PAGE_SIZE;
+				// keep at least the page just loaded
+				c.evict(std::max(c.budget, PAGE_SIZE));
+				c.stats.peak_resident_bytes = std::max(c.stats.peak_resident_bytes, c.stats.resident_bytes);
+				slot.page = loaded;
+			}
+			c.stats.misses++;
+		}
+		slot.key = key;
+	}
+	return reinterpret_cast<char const*>(slot.page->data.data()) + offset % PAGE_SIZE;
+}
+
+PageCache::Stats PageCache::
+get_stats()
+{
+	Cache& c = cache();
+	std::lock_guard<std::mutex> lock(c.mutex);
+	return c.stats;
+}
+
+void PageCache::
+reset_stats()
+{
+	Cache& c = cache();
+	std::lock_guard<std::mutex> lock(c.mutex);
+	c.stats.hits = c.stats.misses = c.stats.evictions = 0;
+	c.stats.peak_resident_bytes = c.stats.resident_bytes;
+}
@@ -0,0 +1,99 @@
+#include <cglib/core/parallel_for.h>
+
+#include <algorithm>
+
+ParallelFor::ParallelFor(int num_threads)
+{
+	if (num_threads <= 0)
+		num_threads = int(std::max(1u, std::thread::hardware_concurrency()));
+	for (int t = 1; t < num_threads; ++t)
+		threads.emplace_back(&ParallelFor::worker, this);
+}
+
+ParallelFor::~ParallelFor()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	start.notify_all();
+	for (auto& t : threads)
+		t.join();
+}
+
+void ParallelFor::run(int n_, std::function<void(int)> const& f)
+{
+	if (threads.empty() || n_ <= 1) {
+		for (int i = 0; i < n_; ++i)
+			f(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		loop = &f;
+		n = n_;
+		next = 0;
+		working = int(threads.size());
+		exception = nullptr;
+		++generation;
+	}
+	start.notify_all();
+	work();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [&]() { return working == 0; });
+	loop = nullptr;
+	if (exception)
+		std::rethrow_exception(exception);
+}
+
+/*
+ * Run indices of the current loop until all are handed out.
+ */
+void ParallelFor::work()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (next < n) {
+		const int i = next++;
+		lock.unlock();
+		try {
+			(*loop)(i);
+		}
+		catch (...) {
+			lock.lock();
+			if (!exception)
+				exception = std::current_exception();
+			next = n;
+			continue;
+		}
+		lock.lock();
+	}
+}
+
+void ParallelFor::worker()
+{
+	int done = 0; // generation this thread last worked on
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			start.wait(lock, [&]() { return quit || generation != done; });
+			if (quit)
+				return;
+			done = generation;
+		}
+		work();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			--working;
+		}
+		finished.notify_one();
+	}
+}
+
+void parallel_for(int n, std::function<void(int)> const& f, int num_threads)
+{
+	if (num_threads <= 0)
+		num_threads = int(std::max(1u, std::thread::hardware_concurrency()));
+	ParallelFor(std::max(1, std::min(num_threads, n))).run(n, f);
+}
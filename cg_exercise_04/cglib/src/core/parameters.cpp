@@ -33,10 +33,17 @@ bool Parameters::parse_command_line(int argc, char const** argv)
 				<< "--create-images      Create assignment images.\n"
 				<< "--gauss              Create the gauss filtered images.\n"
 				<< "--fourier            Calculate inverse fourier transform.\n"
+				<< "--benchmark-textures Compare texture lookups with the linear and the tiled texel layout.\n"
+				<< "--compress-textures  Block compress 8 bit textures and report their size and quality.\n"
 				<< "--noninteractive     Do not start in GUI mode.\n"
 				<< "--stereo             Render in stereo mode.\n"
 				<< "--eye-separation SEP Eye separation.\n"
 				<< "--output FILE        The output file name when rendering in noninteractive mode.\n"
+				<< "--texture-cache DIR  Cache decoded and mipmapped textures in DIR.\n"
+				<< "--texture-memory MB  Page textures from the texture cache, keeping at most MB in memory.\n"
+				<< "--aovs LIST          Comma separated AOVs to write in noninteractive mode, e.g. color,normal,depth,uv,\n"
+				<< "                     primitive_id,material_id,ray_count,time.\n"
+				<< "--aov-output FILE    The AOV file name (.exr for one multi-layer file, .pfm for one file per AOV).\n"
 				<< "--width  N           The output image width.\n"
 				<< "--height N           The output image height.\n"
 				<< "--num-threads N      The number of threads to be used for rendering. Minimum 1.\n"
@@ -68,6 +75,14 @@ bool Parameters::parse_command_line(int argc, char const** argv)
 		{
 			gauss = true;
 		}
+		else if (arg == "--benchmark-textures")
+		{
+			benchmark_textures = true;
+		}
+		else if (arg == "--compress-textures")
+		{
+			compress_textures = true;
+		}
 
 		else
 		{
@@ -87,6 +102,26 @@ bool Parameters::parse_command_line(int argc, char const** argv)
 				is >> output_file_name;
 			}
 
+			else if (arg == "--texture-cache")
+			{
+				success = bool(is >> texture_cache);
+			}
+
+			else if (arg == "--texture-memory")
+			{
+				success = bool(is >> texture_memory) && texture_memory >= 0;
+			}
+
+			else if (arg == "--aovs")
+			{
+				success = bool(is >> aovs);
+			}
+
+			else if (arg == "--aov-output")
+			{
+				success = bool(is >> aov_file_name);
+			}
+
 
 			else if (arg == "--width")
 			{
@@ -0,0 +1,34 @@
+#include <cglib/core/shadow_cache.h>
+
+#include <atomic>
+
+static std::atomic<std::uint64_t> stats_lookups(0);
+static std::atomic<std::uint64_t> stats_hits(0);
+
+void ShadowCache::
+flush_stats()
+{
+	stats_lookups += lookups;
+	stats_hits += hits;
+	lookups = 0;
+	hits = 0;
+}
+
+void ShadowCache::
+reset_stats()
+{
+	stats_lookups.store(0);
+	stats_hits.store(0);
+}
+
+std::uint64_t ShadowCache::
+total_lookups()
+{
+	return stats_lookups.load();
+}
+
+std::uint64_t ShadowCache::
+total_hits()
+{
+	return stats_hits.load();
+}
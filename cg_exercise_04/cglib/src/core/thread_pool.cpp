@@ -102,6 +102,13 @@ void ThreadPool::run_internal(
 
 // -----------------------------------------------------------------------------
 
+bool ThreadPool::done() const
+{
+	return jobs_done() >= num_jobs();
+}
+
+// -----------------------------------------------------------------------------
+
 void ThreadPool::terminate() 
 {
 	m_numJobs.store(0);
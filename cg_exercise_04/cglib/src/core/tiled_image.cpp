@@ -0,0 +1,536 @@
+#include <cglib/core/tiled_image.h>
+#include <cglib/core/image.h>
+#include <cglib/core/assert.h>
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <mutex>
+
+static_assert(TiledImage::BLOCK_SIZE == 4, "TiledImage::index and the BC formats assume blocks of 4x4 pixels");
+
+const char* TiledImage::format_names[TiledImage::FORMAT_COUNT] = {
+    "RGBA32F", "RGBA16F", "RGBA8", "BC1", "BC3"
+};
+
+/*
+ * lookup table from 8 bit color values to floats, shared by all images
+ * with the same gamma. Computed like Image::load, so that texels of a
+ * loaded 8 bit image decode to exactly the values Image::load produced.
+ */
+static float const* gamma_lut(float gamma)
+{
+    static std::mutex mutex;
+    static std::map<float, std::array<float, 256>> luts;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = luts.find(gamma);
+    if (it == luts.end()) {
+        std::array<float, 256> lut;
+        for (int i = 0; i < 256; ++i)
+            lut[i] = float(std::pow(i / 255.0f, gamma));
+        it = luts.insert({ gamma, lut }).first;
+    }
+    return it->second.data();
+}
+
+/*
+ * BC1 and BC3 blocks, see the DirectX documentation on block compression.
+ *
+ * A color block holds two RGB565 endpoints c0, c1 in bits 0-31 and a 2 bit
+ * palette index per pixel in bits 32-63, pixel k = 4 * y + x at bit 32 + 2k.
+ * If c0 > c1 (or always, for BC3) the palette is c0, c1, 2/3 c0 + 1/3 c1
+ * and 1/3 c0 + 2/3 c1, otherwise c0, c1, 1/2 c0 + 1/2 c1 and transparent
+ * black. The encoder only writes the former.
+ *
+ * An alpha block holds two 8 bit endpoints a0, a1 in bits 0-15 and a 3 bit
+ * palette index per pixel from bit 16 on. If a0 > a1, the palette
+ * interpolates 8 values, otherwise 6 values and adds 0 and 255.
+ *
+ * The endpoints are interpolated in the 8 bit (gamma encoded) values of
+ * RGBA8, then decoded with the lookup table.
+ */
+static glm::ivec3 expand_565(std::uint32_t c)
+{
+    const int r = (c >> 11) & 31;
+    const int g = (c >> 5) & 63;
+    const int b = c & 31;
+    return glm::ivec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+}
+
+static std::uint32_t quantize_565(glm::vec3 const& c)
+{
+    const glm::vec3 q = glm::clamp(c, 0.f, 255.f) * glm::vec3(31.f, 63.f, 31.f) / 255.f + 0.5f;
+    return (std::uint32_t(q.r) << 11) | (std::uint32_t(q.g) << 5) | std::uint32_t(q.b);
+}
+
+static void color_palette(std::uint32_t c0, std::uint32_t c1, bool four_colors, glm::ivec3 palette[4])
+{
+    palette[0] = expand_565(c0);
+    palette[1] = expand_565(c1);
+    if (four_colors) {
+        palette[2] = (2 * palette[0] + palette[1]) / 3;
+        palette[3] = (palette[0] + 2 * palette[1]) / 3;
+    }
+    else {
+        palette[2] = (palette[0] + palette[1]) / 2;
+        palette[3] = glm::ivec3(0);
+    }
+}
+
+static int alpha_palette_entry(int a0, int a1, int index)
+{
+    if (index < 2)
+        return index == 0 ? a0 : a1;
+    if (a0 > a1)
+        return ((8 - index) * a0 + (index - 1) * a1) / 7;
+    if (index < 6)
+        return ((6 - index) * a0 + (index - 1) * a1) / 5;
+    return index == 6 ? 0 : 255;
+}
+
+/*
+ * color block with the given endpoints and the closest palette entry for
+ * each pixel. Returns the squared error in *error.
+ */
+static std::uint64_t fit_color_block(glm::vec3 const& e0, glm::vec3 const& e1,
+    glm::vec3 const pixels[16], float* error)
+{
+    std::uint32_t c0 = quantize_565(e0);
+    std::uint32_t c1 = quantize_565(e1);
+    // c0 > c1 selects the four color palette
+    if (c0 < c1)
+        std::swap(c0, c1);
+
+    glm::ivec3 palette[4];
+    color_palette(c0, c1, true, palette);
+
+    std::uint64_t indices = 0;
+    *error = 0.f;
+    for (int k = 0; k < 16; ++k) {
+        int best = 0;
+        float best_error = std::numeric_limits<float>::max();
+        // with c0 == c1 all entries are equal and the three color palette
+        // would be decoded, so only use entry 0
+        for (int p = 0; p < (c0 == c1 ? 1 : 4); ++p) {
+            const glm::vec3 d = glm::vec3(palette[p]) - pixels[k];
+            const float e = glm::dot(d, d);
+            if (e < best_error) {
+                best_error = e;
+                best = p;
+            }
+        }
+        indices |= std::uint64_t(best) << (2 * k);
+        *error += best_error;
+    }
+    return (indices << 32) | (std::uint64_t(c1) << 16) | c0;
+}
+
+/*
+ * Endpoints on the principal axis of the pixel colors, followed by one
+ * least squares refinement of the endpoints for the chosen indices.
+ */
+static std::uint64_t encode_color_block(glm::vec3 const pixels[16])
+{
+    glm::vec3 mean(0.f);
+    glm::vec3 lo(255.f), hi(0.f);
+    for (int k = 0; k < 16; ++k) {
+        mean += pixels[k];
+        lo = glm::min(lo, pixels[k]);
+        hi = glm::max(hi, pixels[k]);
+    }
+    mean /= 16.f;
+
+    glm::mat3 covariance(0.f);
+    for (int k = 0; k < 16; ++k) {
+        const glm::vec3 d = pixels[k] - mean;
+        covariance += glm::outerProduct(d, d);
+    }
+
+    // power iteration, starting at the diagonal of the bounding box
+    glm::vec3 axis = hi - lo;
+    for (int i = 0; i < 8 && glm::dot(axis, axis) > 0.f; ++i) {
+        axis = covariance * axis;
+        const float m = std::max(std::abs(axis.x), std::max(std::abs(axis.y), std::abs(axis.z)));
+        if (m > 0.f)
+            axis /= m;
+    }
+
+    float error;
+    if (glm::dot(axis, axis) == 0.f)
+        return fit_color_block(mean, mean, pixels, &error);
+
+    axis = glm::normalize(axis);
+    float t_min = std::numeric_limits<float>::max();
+    float t_max = -t_min;
+    for (int k = 0; k < 16; ++k) {
+        const float t = glm::dot(pixels[k] - mean, axis);
+        t_min = std::min(t_min, t);
+        t_max = std::max(t_max, t);
+    }
+    std::uint64_t block = fit_color_block(mean + t_max * axis, mean + t_min * axis, pixels, &error);
+
+    // weight of c0 for each palette index
+    static const float weight[4] = { 1.f, 0.f, 2.f / 3.f, 1.f / 3.f };
+    float aa = 0.f, ab = 0.f, bb = 0.f;
+    glm::vec3 ax(0.f), bx(0.f);
+    for (int k = 0; k < 16; ++k) {
+        const float a = weight[(block >> (32 + 2 * k)) & 3];
+        const float b = 1.f - a;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        ax += a * pixels[k];
+        bx += b * pixels[k];
+    }
+    const float det = aa * bb - ab * ab;
+    if (det > 1e-3f) {
+        float refined_error;
+        const std::uint64_t refined = fit_color_block(
+            (bb * ax - ab * bx) / det, (aa * bx - ab * ax) / det, pixels, &refined_error);
+        if (refined_error < error)
+            block = refined;
+    }
+    return block;
+}
+
+static std::uint64_t encode_alpha_block(int const alpha[16])
+{
+    const int a0 = *std::max_element(alpha, alpha + 16);
+    const int a1 = *std::min_element(alpha, alpha + 16);
+    std::uint64_t indices = 0;
+    if (a0 > a1) {
+        for (int k = 0; k < 16; ++k) {
+            int best = 0;
+            for (int p = 1; p < 8; ++p) {
+                if (std::abs(alpha_palette_entry(a0, a1, p) - alpha[k])
+                  < std::abs(alpha_palette_entry(a0, a1, best) - alpha[k]))
+                    best = p;
+            }
+            indices |= std::uint64_t(best) << (3 * k);
+        }
+    }
+    return (indices << 16) | (std::uint64_t(a1) << 8) | std::uint64_t(a0);
+}
+
+/*
+ * bytes of the pixels of an image
+ */
+static std::size_t storage_size(int width, int height, TiledImage::Format format)
+{
+    const int B = TiledImage::BLOCK_SIZE;
+    const std::size_t blocks = std::size_t((width + B - 1) / B) * ((height + B - 1) / B);
+    switch (format) {
+        case TiledImage::RGBA32F: return blocks * B * B * sizeof(glm::vec4);
+        case TiledImage::RGBA16F: return blocks * B * B * sizeof(std::uint64_t);
+        case TiledImage::RGBA8:   return blocks * B * B * sizeof(std::uint32_t);
+        case TiledImage::BC1:     return blocks * sizeof(std::uint64_t);
+        case TiledImage::BC3:     return blocks * 2 * sizeof(std::uint64_t);
+        default:                  cg_assert(!"invalid format"); return 0;
+    }
+}
+
+TiledImage::TiledImage() :
+    m_width(0), m_height(0), m_blocks_x(0), m_format(RGBA32F), m_gamma(1.f), m_lut(nullptr),
+    m_data(nullptr), m_size(0), m_offset(0)
+{ }
+
+TiledImage::TiledImage(int width, int height, Format format, float gamma,
+    std::shared_ptr<void const> owner, void const* data) :
+    m_width(width),
+    m_height(height),
+    m_blocks_x((width + BLOCK_SIZE - 1) / BLOCK_SIZE),
+    m_format(format),
+    m_gamma(gamma),
+    m_lut(format == RGBA8 || is_compressed(format) ? gamma_lut(gamma) : nullptr),
+    m_owner(std::move(owner)),
+    m_data(data),
+    m_size(storage_size(width, height, format)),
+    m_offset(0)
+{
+    cg_assert(m_owner && m_data);
+}
+
+TiledImage::TiledImage(int width, int height, Format format, float gamma,
+    std::shared_ptr<PageCache::File> file, std::size_t offset) :
+    m_width(width),
+    m_height(height),
+    m_blocks_x((width + BLOCK_SIZE - 1) / BLOCK_SIZE),
+    m_format(format),
+    m_gamma(gamma),
+    m_lut(format == RGBA8 || is_compressed(format) ? gamma_lut(gamma) : nullptr),
+    m_data(nullptr),
+    m_size(storage_size(width, height, format)),
+    m_file(std::move(file)),
+    m_offset(offset)
+{
+    cg_assert(m_file);
+    cg_assert(m_offset % 16 == 0);
+}
+
+TiledImage::TiledImage(TiledImage const& other) :
+    m_width(other.m_width),
+    m_height(other.m_height),
+    m_blocks_x(other.m_blocks_x),
+    m_format(other.m_format),
+    m_gamma(other.m_gamma),
+    m_lut(other.m_lut),
+    m_storage(other.m_storage),
+    m_owner(other.m_owner),
+    m_data(other.m_owner || other.m_file ? other.m_data : m_storage.data()),
+    m_size(other.m_size),
+    m_file(other.m_file),
+    m_offset(other.m_offset)
+{ }
+
+TiledImage& TiledImage::operator=(TiledImage const& other)
+{
+    TiledImage copy(other);
+    return *this = std::move(copy);
+}
+
+template <class T>
+T* TiledImage::mutable_pixels()
+{
+    if (m_owner) {
+        // copy on write
+        m_storage.resize((m_size + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+        std::memcpy(m_storage.data(), m_data, m_size);
+        m_owner.reset();
+        m_data = m_storage.data();
+    }
+    else if (m_file) {
+        m_storage.resize((m_size + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+        if (!m_file->read(m_offset, m_size, m_storage.data()))
+            std::memset(m_storage.data(), 0, m_size);
+        m_file.reset();
+        m_offset = 0;
+        m_data = m_storage.data();
+    }
+    return static_cast<T*>(static_cast<void*>(m_storage.data()));
+}
+
+TiledImage::TiledImage(Image const& image, Format format, float gamma) :
+    m_width(image.getWidth()),
+    m_height(image.getHeight()),
+    m_blocks_x((image.getWidth() + BLOCK_SIZE - 1) / BLOCK_SIZE),
+    m_format(format),
+    m_gamma(gamma),
+    m_lut(format == RGBA8 || is_compressed(format) ? gamma_lut(gamma) : nullptr),
+    m_size(storage_size(m_width, m_height, format)),
+    m_offset(0)
+{
+    const int blocks_y = (m_height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    m_storage.resize((m_size + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+    m_data = m_storage.data();
+    if (is_compressed(m_format)) {
+        // pixels outside of the image repeat the last row and column
+        glm::vec4 pixels[BLOCK_SIZE * BLOCK_SIZE];
+        for (int by = 0; by < blocks_y; ++by) {
+            for (int bx = 0; bx < m_blocks_x; ++bx) {
+                for (int k = 0; k < BLOCK_SIZE * BLOCK_SIZE; ++k) {
+                    pixels[k] = image.getPixel(
+                        std::min(bx * BLOCK_SIZE + k % BLOCK_SIZE, m_width - 1),
+                        std::min(by * BLOCK_SIZE + k / BLOCK_SIZE, m_height - 1));
+                }
+                encode_block(by * m_blocks_x + bx, pixels);
+            }
+        }
+        return;
+    }
+    glm::vec4 const* src = image.getPixels();
+    for (int j = 0; j < m_height; ++j) {
+        glm::vec4 const* row = src + std::size_t(j) * m_width;
+        switch (m_format) {
+            case RGBA32F: {
+                glm::vec4* dst = mutable_pixels<glm::vec4>();
+                for (int i = 0; i < m_width; ++i)
+                    dst[index(i, j)] = row[i];
+                break;
+            }
+            case RGBA16F: {
+                std::uint64_t* dst = mutable_pixels<std::uint64_t>();
+                for (int i = 0; i < m_width; ++i)
+                    dst[index(i, j)] = glm::packHalf4x16(row[i]);
+                break;
+            }
+            default: {
+                std::uint32_t* dst = mutable_pixels<std::uint32_t>();
+                for (int i = 0; i < m_width; ++i)
+                    dst[index(i, j)] = encode_rgba8(row[i]);
+                break;
+            }
+        }
+    }
+}
+
+glm::vec4 TiledImage::getPixel(int i, int j) const
+{
+    cg_assert(i >= 0);
+    cg_assert(j >= 0);
+    cg_assert(i < m_width);
+    cg_assert(j < m_height);
+    const int idx = index(i, j);
+    switch (m_format) {
+        case RGBA16F:
+            return glm::unpackHalf4x16(*pixels<std::uint64_t>(idx));
+        case RGBA8:
+            return decode_rgba8(*pixels<std::uint32_t>(idx));
+        case BC1:
+        case BC3:
+            return decode_compressed(i, j);
+        default:
+            return *pixels<glm::vec4>(idx);
+    }
+}
+
+void TiledImage::getPixels(int i0, int i1, int j0, int j1, glm::vec4 out[4]) const
+{
+    cg_assert(i0 >= 0 && i0 < m_width && i1 >= 0 && i1 < m_width);
+    cg_assert(j0 >= 0 && j0 < m_height && j1 >= 0 && j1 < m_height);
+    const int idx[4] = { index(i0, j0), index(i0, j1), index(i1, j0), index(i1, j1) };
+    switch (m_format) {
+        case RGBA16F:
+            for (int k = 0; k < 4; ++k)
+                out[k] = glm::unpackHalf4x16(*pixels<std::uint64_t>(idx[k]));
+            break;
+        case RGBA8:
+            for (int k = 0; k < 4; ++k)
+                out[k] = decode_rgba8(*pixels<std::uint32_t>(idx[k]));
+            break;
+        case BC1:
+        case BC3:
+            out[0] = decode_compressed(i0, j0);
+            out[1] = decode_compressed(i0, j1);
+            out[2] = decode_compressed(i1, j0);
+            out[3] = decode_compressed(i1, j1);
+            break;
+        default:
+            for (int k = 0; k < 4; ++k)
+                out[k] = *pixels<glm::vec4>(idx[k]);
+            break;
+    }
+}
+
+void TiledImage::setPixel(int i, int j, const glm::vec4& pixel)
+{
+    cg_assert(i >= 0);
+    cg_assert(j >= 0);
+    cg_assert(i < m_width);
+    cg_assert(j < m_height);
+    if (is_compressed(m_format)) {
+        const int bx = i / BLOCK_SIZE;
+        const int by = j / BLOCK_SIZE;
+        glm::vec4 pixels[BLOCK_SIZE * BLOCK_SIZE];
+        for (int k = 0; k < BLOCK_SIZE * BLOCK_SIZE; ++k) {
+            pixels[k] = getPixel(
+                std::min(bx * BLOCK_SIZE + k % BLOCK_SIZE, m_width - 1),
+                std::min(by * BLOCK_SIZE + k / BLOCK_SIZE, m_height - 1));
+        }
+        pixels[(j % BLOCK_SIZE) * BLOCK_SIZE + i % BLOCK_SIZE] = pixel;
+        encode_block(by * m_blocks_x + bx, pixels);
+        return;
+    }
+    const int idx = index(i, j);
+    switch (m_format) {
+        case RGBA32F: mutable_pixels<glm::vec4>()[idx] = pixel; break;
+        case RGBA16F: mutable_pixels<std::uint64_t>()[idx] = glm::packHalf4x16(pixel); break;
+        case RGBA8:   mutable_pixels<std::uint32_t>()[idx] = encode_rgba8(pixel); break;
+        default:      break;
+    }
+}
+
+glm::vec4 TiledImage::decode_compressed(int i, int j) const
+{
+    const int block = (j / BLOCK_SIZE) * m_blocks_x + i / BLOCK_SIZE;
+    const int k = (j % BLOCK_SIZE) * BLOCK_SIZE + i % BLOCK_SIZE;
+
+    // BC3 alpha and color block, or BC1 color block
+    std::uint64_t const* blocks = pixels<std::uint64_t>(m_format == BC3 ? 2 * block : block);
+    const std::uint64_t color = m_format == BC3 ? blocks[1] : blocks[0];
+    const std::uint32_t c0 = std::uint32_t(color & 0xffff);
+    const std::uint32_t c1 = std::uint32_t((color >> 16) & 0xffff);
+    const int index = int((color >> (32 + 2 * k)) & 3);
+    const bool four_colors = m_format == BC3 || c0 > c1;
+
+    glm::ivec3 palette[4];
+    color_palette(c0, c1, four_colors, palette);
+    const glm::ivec3 rgb = palette[index];
+
+    float alpha = 1.f;
+    if (m_format == BC3) {
+        const std::uint64_t a = blocks[0];
+        alpha = float(alpha_palette_entry(int(a & 0xff), int((a >> 8) & 0xff),
+            int((a >> (16 + 3 * k)) & 7))) / 255.0f;
+    }
+    else if (!four_colors && index == 3) {
+        alpha = 0.f;
+    }
+    return glm::vec4(m_lut[rgb.r], m_lut[rgb.g], m_lut[rgb.b], alpha);
+}
+
+void TiledImage::encode_block(int block, glm::vec4 const pixels[BLOCK_SIZE * BLOCK_SIZE])
+{
+    glm::vec3 color[16];
+    int alpha[16];
+    for (int k = 0; k < 16; ++k) {
+        const std::uint32_t p = encode_rgba8(pixels[k]);
+        color[k] = glm::vec3(float(p & 0xff), float((p >> 8) & 0xff), float((p >> 16) & 0xff));
+        alpha[k] = int(p >> 24);
+    }
+    std::uint64_t* blocks = mutable_pixels<std::uint64_t>();
+    if (m_format == BC3) {
+        blocks[2 * block] = encode_alpha_block(alpha);
+        blocks[2 * block + 1] = encode_color_block(color);
+    }
+    else {
+        blocks[block] = encode_color_block(color);
+    }
+}
+
+std::uint32_t TiledImage::encode_rgba8(glm::vec4 const& pixel) const
+{
+    std::uint32_t p = 0;
+    for (int c = 0; c < 3; ++c) {
+        // closest entry of the (increasing) lookup table
+        const int hi = int(std::lower_bound(m_lut, m_lut + 256, pixel[c]) - m_lut);
+        int v = std::min(hi, 255);
+        if (hi > 0 && (hi == 256 || pixel[c] - m_lut[hi - 1] <= m_lut[hi] - pixel[c]))
+            v = hi - 1;
+        p |= std::uint32_t(v) << (8 * c);
+    }
+    const float a = std::max(0.f, std::min(1.f, pixel.a));
+    return p | (std::uint32_t(std::lround(a * 255.f)) << 24);
+}
+
+void TiledImage::copy_to(Image* image) const
+{
+    cg_assert(image);
+    image->setSize(m_width, m_height);
+    for (int j = 0; j < m_height; ++j) {
+        for (int i = 0; i < m_width; ++i) {
+            image->setPixel(i, j, getPixel(i, j));
+        }
+    }
+}
+
+double TiledImage::psnr(TiledImage const& reference) const
+{
+    cg_assert(m_width == reference.m_width && m_height == reference.m_height);
+    double squared_error = 0.0;
+    for (int j = 0; j < m_height; ++j) {
+        for (int i = 0; i < m_width; ++i) {
+            const glm::vec4 d = getPixel(i, j) - reference.getPixel(i, j);
+            squared_error += double(glm::dot(d, d));
+        }
+    }
+    if (squared_error == 0.0)
+        return std::numeric_limits<double>::infinity();
+    const double mse = squared_error / (4.0 * m_width * m_height);
+    return -10.0 * std::log10(mse);
+}
@@ -0,0 +1,70 @@
+#include <cglib/rt/accumulation_buffer.h>
+
+#include <cglib/core/assert.h>
+#include <cglib/core/stereo.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+AccumulationBuffer::AccumulationBuffer(int width, int height) :
+	m_width(width),
+	m_height(height),
+	m_mean(width * height, glm::vec3(0.f)),
+	m_m2(width * height, glm::vec3(0.f)),
+	m_num_samples(width * height, 0)
+{ }
+
+void AccumulationBuffer::clear()
+{
+	std::fill(m_mean.begin(), m_mean.end(), glm::vec3(0.f));
+	std::fill(m_m2.begin(), m_m2.end(), glm::vec3(0.f));
+	std::fill(m_num_samples.begin(), m_num_samples.end(), 0);
+	m_total_samples = 0;
+}
+
+void AccumulationBuffer::add_sample(int x, int y, glm::vec3 const& color)
+{
+	cg_assert(x >= 0 && x < m_width);
+	cg_assert(y >= 0 && y < m_height);
+	int const idx = x + y * m_width;
+	int const n = ++m_num_samples[idx];
+	++m_total_samples;
+	// Welford's update, avoids growing sums for long accumulation runs
+	glm::vec3 const delta = color - m_mean[idx];
+	m_mean[idx] += delta / float(n);
+	m_m2[idx]   += delta * (color - m_mean[idx]);
+}
+
+glm::vec3 const& AccumulationBuffer::get_mean(int x, int y) const
+{
+	cg_assert(x >= 0 && x < m_width);
+	cg_assert(y >= 0 && y < m_height);
+	return m_mean[x + y * m_width];
+}
+
+glm::vec3 AccumulationBuffer::get_variance(int x, int y) const
+{
+	int const n = get_num_samples(x, y);
+	if (n < 2)
+		return glm::vec3(0.f);
+	return m_m2[x + y * m_width] / float(n - 1);
+}
+
+float AccumulationBuffer::get_relative_error(int x, int y) const
+{
+	int const n = get_num_samples(x, y);
+	if (n < 2)
+		return std::numeric_limits<float>::infinity();
+	float const variance = std::max(0.f, luminance(get_variance(x, y)));
+	float const mean     = std::max(0.f, luminance(get_mean(x, y)));
+	// the constant keeps dark pixels from demanding samples forever
+	return std::sqrt(variance / float(n)) / (mean + 1e-2f);
+}
+
+int AccumulationBuffer::get_num_samples(int x, int y) const
+{
+	cg_assert(x >= 0 && x < m_width);
+	cg_assert(y >= 0 && y < m_height);
+	return m_num_samples[x + y * m_width];
+}
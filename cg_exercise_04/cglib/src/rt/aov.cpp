@@ -0,0 +1,137 @@
+#include <cglib/rt/aov.h>
+#include <cglib/rt/intersection.h>
+
+#include <cglib/core/assert.h>
+#include <cglib/core/exr.h>
+
+#include <iostream>
+#include <sstream>
+
+static char const* const aov_names[AOV_COUNT] = {
+	"color", "normal", "depth", "uv", "primitive_id", "material_id", "ray_count", "time"
+};
+
+// channels in the exr file, the color is stored as the default layer
+static char const* const aov_channels[AOV_COUNT] = {
+	"RGB", "XYZ", "Z", "UV", "Y", "Y", "Y", "Y"
+};
+
+AOVBuffers::
+AOVBuffers(int width, int height, unsigned aovs_) :
+	aovs(aovs_),
+	images(AOV_COUNT)
+{
+	for (int i = 0; i < AOV_COUNT; ++i) {
+		if (has(AOV(i))) {
+			images[i].setSize(width, height);
+			images[i].clear(glm::vec4(0.f, 0.f, 0.f, 1.f));
+		}
+	}
+}
+
+char const* AOVBuffers::
+get_name(AOV aov)
+{
+	cg_assert(aov >= 0 && aov < AOV_COUNT);
+	return aov_names[aov];
+}
+
+bool AOVBuffers::
+parse(std::string const& names, unsigned* aovs)
+{
+	cg_assert(aovs);
+	*aovs = 0;
+	std::istringstream is(names);
+	std::string name;
+	while (std::getline(is, name, ',')) {
+		if (name.empty())
+			continue;
+		int i = 0;
+		while (i < AOV_COUNT && name != aov_names[i])
+			++i;
+		if (i == AOV_COUNT) {
+			std::cerr << "unknown AOV \"" << name << "\"" << std::endl;
+			return false;
+		}
+		*aovs |= 1u << i;
+	}
+	return true;
+}
+
+Image const& AOVBuffers::
+get(AOV aov) const
+{
+	cg_assert(has(aov));
+	return images[aov];
+}
+
+void AOVBuffers::
+add_sample(int x, int y, Intersection const& isect, bool normal_mapping,
+	int num_rays, float time_ms)
+{
+	auto set = [&](AOV aov, glm::vec3 const& value) {
+		if (has(aov))
+			images[aov].setPixel(x, y, glm::vec4(value, 1.f));
+	};
+	auto add = [&](AOV aov, float value) {
+		if (has(aov)) {
+			const float sum = images[aov].getPixel(x, y).x + value;
+			images[aov].setPixel(x, y, glm::vec4(glm::vec3(sum), 1.f));
+		}
+	};
+
+	if (isect.isValid()) {
+		set(AOV_NORMAL, glm::normalize(normal_mapping ? isect.shading_normal : isect.normal));
+		set(AOV_DEPTH, glm::vec3(isect.t));
+		set(AOV_UV, glm::vec3(isect.uv, 0.f));
+		set(AOV_PRIMITIVE_ID, glm::vec3(float(isect.primitive_id)));
+		set(AOV_MATERIAL_ID, glm::vec3(float(isect.material_id)));
+	}
+	else {
+		set(AOV_NORMAL, glm::vec3(0.f));
+		set(AOV_DEPTH, glm::vec3(0.f));
+		set(AOV_UV, glm::vec3(0.f));
+		set(AOV_PRIMITIVE_ID, glm::vec3(-1.f));
+		set(AOV_MATERIAL_ID, glm::vec3(-1.f));
+	}
+	add(AOV_RAY_COUNT, float(num_rays));
+	add(AOV_TIME, time_ms);
+}
+
+void AOVBuffers::
+set_color(Image const& frame_buffer)
+{
+	if (!has(AOV_COLOR))
+		return;
+	cg_assert(frame_buffer.getWidth() == images[AOV_COLOR].getWidth());
+	cg_assert(frame_buffer.getHeight() == images[AOV_COLOR].getHeight());
+	images[AOV_COLOR] = frame_buffer;
+}
+
+bool AOVBuffers::
+save(std::string const& path) const
+{
+	const size_t dot = path.find_last_of('.');
+	const std::string stem = path.substr(0, dot);
+	const std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+
+	if (extension == "exr") {
+		std::vector<ExrChannel> channels;
+		for (int i = 0; i < AOV_COUNT; ++i) {
+			if (!has(AOV(i)))
+				continue;
+			const std::string layer = i == AOV_COLOR ? "" : std::string(aov_names[i]) + ".";
+			for (int c = 0; aov_channels[i][c]; ++c) {
+				channels.push_back({ layer + aov_channels[i][c], &images[i], c });
+			}
+		}
+		return channels.empty() || save_exr(path, channels);
+	}
+
+	bool success = true;
+	for (int i = 0; i < AOV_COUNT; ++i) {
+		if (has(AOV(i)))
+			success = images[i].save_pfm(stem + "." + aov_names[i] + ".pfm") && success;
+	}
+	return success;
+}
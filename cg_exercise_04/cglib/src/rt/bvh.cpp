@@ -4,6 +4,9 @@
 #include <cglib/rt/intersection.h>
 #include <cglib/rt/triangle_soup.h>
 #include <cglib/rt/interpolate.h>
+#include <cglib/rt/intersection_tests.h>
+#include <cglib/rt/raytracing_context.h>
+#include <cglib/rt/scene.h>
 
 #include <cglib/core/camera.h>
 
@@ -22,7 +25,7 @@ BVH(const TriangleSoup &triangle_soup_)
 }
 
 bool BVH::
-intersect_local(Ray const& ray, Intersection* isect) const
+intersect_local(Ray const& ray, HitRecord* hit) const
 {
 	float t_min = 0.0f;
 	float t_max = FLT_MAX;
@@ -30,26 +33,193 @@ intersect_local(Ray const& ray, Intersection* isect) const
 	if(!nodes[0].aabb.intersect(ray, t_min, t_max))
 		return false;
 
-	return intersect_recursive(ray, 0, &t_max, isect);
+	return intersect_recursive(ray, 0, &t_max, hit);
+}
+
+static glm::vec3 full_barycentric(HitRecord const& hit)
+{
+	return glm::vec3(1.f - hit.bary.x - hit.bary.y, hit.bary.x, hit.bary.y);
+}
+
+unsigned BVH::
+intersect_pair_local(Ray const rays[2], HitRecord hits[2]) const
+{
+	const glm::vec3 div[2] = { 1.0f / rays[0].direction, 1.0f / rays[1].direction };
+	float nearest[2] = { FLT_MAX, FLT_MAX };
+	unsigned found = 0;
+
+	int stack[MAX_TRAVERSAL_STACK];
+	int stack_size = 0;
+	stack[stack_size++] = 0;
+	while (stack_size > 0) {
+		const Node &n = nodes[stack[--stack_size]];
+
+		// rays that can still find a closer hit in this node
+		unsigned active = 0;
+		for (int i = 0; i < 2; ++i) {
+			float t_min = 0.0f;
+			float t_max = nearest[i];
+			if (n.aabb.intersect(rays[i], t_min, t_max, div[i]))
+				active |= 1u << i;
+		}
+		if (!active)
+			continue;
+
+		if (n.left < 0) {
+			for (int k = 0; k < n.num_triangles; k++) {
+				const int x = triangle_indices[n.triangle_idx + k];
+				for (int i = 0; i < 2; ++i) {
+					if (!(active & (1u << i)))
+						continue;
+					float dist;
+					glm::vec3 b;
+					if (intersect_triangle(rays[i].origin, rays[i].direction,
+								triangle_soup.vertices[x * 3 + 0],
+								triangle_soup.vertices[x * 3 + 1],
+								triangle_soup.vertices[x * 3 + 2],
+								b, dist)
+						&& dist <= nearest[i]) {
+						nearest[i] = dist;
+						hits[i].t = dist;
+						hits[i].primitive_id = x;
+						hits[i].bary = glm::vec2(b.y, b.z);
+						found |= 1u << i;
+					}
+				}
+			}
+		}
+		else {
+			cg_assert(stack_size + 2 <= MAX_TRAVERSAL_STACK);
+			stack[stack_size++] = n.right;
+			stack[stack_size++] = n.left;
+		}
+	}
+	return found;
+}
+
+float BVH::
+world_distance_scale(Ray const& ray) const
+{
+	// the local ray direction is normalized by transform_ray, so a unit
+	// step along it covers 1/|M^-1 d| in world space
+	return 1.0f / glm::length(glm::mat3(transform_world_to_object) * ray.direction);
 }
 
 bool BVH::
-intersect(Ray const& ray, Intersection* isect) const
+intersect(Ray const& ray, HitRecord* hit) const
 {
+	cg_assert(hit);
 	// transform ray in object space
 	const Ray ray_local = transform_ray(ray, transform_world_to_object);
-	Intersection isect_local;
-	if (intersect_local(ray_local, &isect_local)) {
-		if (isect) {
-			*isect = transform_intersection(isect_local, 
-				transform_object_to_world, transform_object_to_world_normal);
-			isect->t = glm::length(ray.origin-isect->position);
-		}
+	HitRecord hit_local;
+	if (intersect_local(ray_local, &hit_local)) {
+		*hit = hit_local;
+		hit->t = hit_local.t * world_distance_scale(ray);
 		return true;
 	}
 	return false;
 }
 
+unsigned BVH::
+intersect_pair(Ray const rays[2], HitRecord hits[2]) const
+{
+	cg_assert(hits);
+	const Ray rays_local[2] = {
+		transform_ray(rays[0], transform_world_to_object),
+		transform_ray(rays[1], transform_world_to_object)
+	};
+	HitRecord hits_local[2];
+	const unsigned found = intersect_pair_local(rays_local, hits_local);
+	for (int i = 0; i < 2; ++i) {
+		if (found & (1u << i)) {
+			hits[i] = hits_local[i];
+			hits[i].t = hits_local[i].t * world_distance_scale(rays[i]);
+		}
+	}
+	return found;
+}
+
+bool BVH::
+occluded(Ray const& ray, float t_max, HitRecord* hit) const
+{
+	cg_assert(hit);
+	const Ray ray_local = transform_ray(ray, transform_world_to_object);
+	const glm::vec3 div = 1.0f / ray_local.direction;
+	const float scale = world_distance_scale(ray);
+	const float t_max_local = t_max / scale;
+
+	int stack[MAX_TRAVERSAL_STACK];
+	int stack_size = 0;
+	stack[stack_size++] = 0;
+	while (stack_size > 0) {
+		const Node &n = nodes[stack[--stack_size]];
+
+		float t_min_box = 0.0f;
+		float t_max_box = t_max_local;
+		if (!n.aabb.intersect(ray_local, t_min_box, t_max_box, div))
+			continue;
+
+		if (n.left < 0) {
+			for (int k = 0; k < n.num_triangles; k++) {
+				const int x = triangle_indices[n.triangle_idx + k];
+				float dist;
+				glm::vec3 b;
+				if (!intersect_triangle(ray_local.origin, ray_local.direction,
+							triangle_soup.vertices[x * 3 + 0],
+							triangle_soup.vertices[x * 3 + 1],
+							triangle_soup.vertices[x * 3 + 2],
+							b, dist)
+					|| dist >= t_max_local)
+					continue;
+
+				hit->primitive_id = x;
+				hit->bary = glm::vec2(b.y, b.z);
+				hit->t = dist * scale;
+				return true;
+			}
+		}
+		else {
+			cg_assert(stack_size + 2 <= MAX_TRAVERSAL_STACK);
+			stack[stack_size++] = n.right;
+			stack[stack_size++] = n.left;
+		}
+	}
+	return false;
+}
+
+bool BVH::
+intersect_primitive(Ray const& ray, uint32_t primitive_id, HitRecord* hit) const
+{
+	cg_assert(hit);
+	cg_assert(int(primitive_id) < triangle_soup.num_triangles);
+	const Ray ray_local = transform_ray(ray, transform_world_to_object);
+	const int x = int(primitive_id);
+	float dist;
+	glm::vec3 b;
+	if (!intersect_triangle(ray_local.origin, ray_local.direction,
+				triangle_soup.vertices[x * 3 + 0],
+				triangle_soup.vertices[x * 3 + 1],
+				triangle_soup.vertices[x * 3 + 2],
+				b, dist))
+		return false;
+
+	hit->primitive_id = primitive_id;
+	hit->bary = glm::vec2(b.y, b.z);
+	hit->t = dist * world_distance_scale(ray);
+	return true;
+}
+
+void BVH::
+fill_intersection(Ray const& ray, HitRecord const& hit, Intersection* isect) const
+{
+	cg_assert(isect);
+	Intersection isect_local;
+	triangle_soup.fill_intersection(&isect_local, hit.primitive_id, hit.t, full_barycentric(hit));
+	*isect = transform_intersection(isect_local,
+		transform_object_to_world, transform_object_to_world_normal);
+	isect->t = hit.t;
+}
+
 void BVH::
 sanity_checks()
 {
@@ -86,11 +256,29 @@ intersect_count(const Ray &ray, int idx, int depth)
 	}
 }
 
+void BVH::
+evaluate_material(Intersection* isect) const
+{
+	RaytracingContext const* context = RaytracingContext::get_active();
+	// the normal map is not used for triangle meshes
+	const unsigned flags = MaterialSample::required_flags(context->params)
+		& ~MaterialSample::EVALUATE_NORMAL_MAP;
+	const int material_id = triangle_soup.material_ids[isect->primitive_id];
+	if (triangle_soup.material_table_offset >= 0) {
+		isect->material_id = triangle_soup.material_table_offset + material_id;
+		context->get_active_scene()->material_table.evaluate(
+			isect->material_id, *isect, flags, &isect->material);
+	}
+	else {
+		isect->material_id = -1;
+		isect->material.evaluate(triangle_soup.materials[material_id], *isect, flags);
+	}
+}
+
 void BVH::
 compute_shading_info(Intersection* isect) {
 	cg_assert(isect);
-	auto &material_ = triangle_soup.materials[triangle_soup.material_ids[isect->primitive_id]];
-	isect->material.evaluate(material_, *isect);
+	evaluate_material(isect);
 }
 
 void BVH::
@@ -119,6 +307,5 @@ compute_shading_info(const Ray rays[4], Intersection* isect) {
 	}
 
 	isect->dudv = glm::abs(uv_max - uv_min);
-	auto &material_ = triangle_soup.materials[triangle_soup.material_ids[isect->primitive_id]];
-	isect->material.evaluate(material_, *isect);
+	evaluate_material(isect);
 }
@@ -1,115 +1,294 @@
 #include <cglib/rt/host_render.h>
 #include <cglib/rt/render_data.h>
 #include <cglib/core/heatmap.h>
+#include <cglib/core/page_cache.h>
 #include <cglib/rt/ray.h>
 #include <cglib/rt/renderer.h>
 #include <cglib/imgui/imgui.h>
 #include <cglib/rt/bvh.h>
 
+/*
+ * Calls a PixelFunc. If it wraps a plain function, the function pointer is
+ * taken out of the std::function once per launch and called directly.
+ */
+class PixelCall
+{
+public:
+	typedef glm::vec3 (*Function)(int, int, RaytracingContext const&, RenderData &);
+
+	PixelCall() {}
+	explicit PixelCall(HostRender::PixelFunc const* render_pixel) :
+		pixel_func(render_pixel)
+	{
+		if (Function const* target = render_pixel->target<Function>())
+			function = *target;
+	}
+
+	explicit operator bool() const { return pixel_func != nullptr; }
+
+	glm::vec3 operator()(int x, int y, RaytracingContext const& context, RenderData& data) const
+	{
+		return function ? function(x, y, context, data) : (*pixel_func)(x, y, context, data);
+	}
+
+private:
+	HostRender::PixelFunc const* pixel_func = nullptr;
+	Function function = nullptr;
+};
+
+/*
+ * Everything that depends on the scene or the render mode, resolved once
+ * per launch so that the per pixel work does not have to look it up.
+ */
+struct HostRender::LaunchState
+{
+	RaytracingContext const* context = nullptr;
+	PixelCall render_pixel;
+	TileFunc render_tile = nullptr;
+	int pass = -1;
+	AOVBuffers* aovs = nullptr;
+	ImageTexture const* display_texture = nullptr; // see Scene::get_display_texture
+	float display_aspect = 1.f;
+	std::vector<BVH*> bvhs; // BVHs of the active scene, for BVH_TIME and AABB_INTERSECT_COUNT
+};
+
+// pseudo render mode for scenes that display a texture
+static const int DISPLAY_TEXTURE = RaytracingParameters::RENDER_MODE_COUNT;
+
+/*
+ * Render both eyes of a stereo pixel. The right eye is traced along with
+ * the samples of the left one (see StereoPair), render_pixel only renders
+ * it on its own if it did not take any samples through trace_recursive.
+ */
+static void render_stereo_pixel(PixelCall const& render_pixel, int x, int y,
+		RaytracingContext const& context, RenderData& data,
+		glm::vec3* left, glm::vec3* right)
+{
+	StereoPair pair;
+	data.stereo = &pair;
+	data.camera_mode = Camera::StereoLeft;
+	*left = render_pixel(x, y, context, data);
+	data.stereo = nullptr;
+
+	if (pair.num_samples > 0) {
+		*right = pair.right / float(pair.num_samples);
+	}
+	else {
+		data.wavelength_sample = -1.f;
+		data.camera_mode = Camera::StereoRight;
+		*right = render_pixel(x, y, context, data);
+	}
+}
+
 int HostRender::run(RaytracingContext& context, 
 		PixelFunc const& render_pixel, 
 		int kill_timeout_seconds,
 		std::function<void()> const& render_overlay)
 {
-	auto render_pixel_wrapper = [&](int x, int y, RaytracingContext const &ctx, ThreadLocalData *tld)
-		-> glm::vec3
-		{
-			RenderData data(context, tld);
-			switch(context.params.render_mode) {
+	cg_assert(render_pixel);
+	RenderFunc render_func;
+	render_func.pixel = &render_pixel;
+	return run(context, render_func, kill_timeout_seconds, render_overlay);
+}
 
-				case RaytracingParameters::RECURSIVE:
-					if (context.params.stereo)
-					{
-						data.camera_mode = Camera::StereoLeft;
-						auto const left = render_pixel(x, y, ctx, data);
-						data.camera_mode = Camera::StereoRight;
-						auto const right = render_pixel(x, y, ctx, data);
-						return combine_stereo(left, right);
-					}
-					else
-					{
-						return render_pixel(x, y, ctx, data);
-					}
+int HostRender::run(RaytracingContext& context, 
+		TileFunc render_tile, 
+		int kill_timeout_seconds,
+		std::function<void()> const& render_overlay)
+{
+	cg_assert(render_tile);
+	RenderFunc render_func;
+	render_func.tile = render_tile;
+	return run(context, render_func, kill_timeout_seconds, render_overlay);
+}
 
-				case RaytracingParameters::DESATURATE:
-					if (context.params.stereo)
-					{
-						data.camera_mode = Camera::StereoLeft;
-						auto const left = render_pixel(x, y, ctx, data);
-						data.camera_mode = Camera::StereoRight;
-						auto const right = render_pixel(x, y, ctx, data);
-						return combine_stereo(desaturate(left), desaturate(right));
-					}
-					else
-					{
-						return desaturate(render_pixel(x, y, ctx, data));
-					}
+int HostRender::run(RaytracingContext& context, 
+		RenderFunc const& render_func, 
+		int kill_timeout_seconds,
+		std::function<void()> const& render_overlay)
+{
+	if (context.params.interactive)
+	{
+		return run_interactive(context, render_func, render_overlay);
+	}
+	else
+	{
+		return run_noninteractive(context, render_func, 
+				kill_timeout_seconds);
+	}
+}
 
-				case RaytracingParameters::NUM_RAYS:
-					render_pixel(x, y, ctx, data);
-					return heatmap(float(data.num_cast_rays - 1) / 64.0f);
-				case RaytracingParameters::NORMAL:
-					render_pixel(x, y, ctx, data);
-					if (context.params.normal_mapping)
-						return glm::normalize(data.isect.shading_normal) * 0.5f + glm::vec3(0.5f);
-					else
-					{
-						if (data.isect.isValid())
-							return glm::normalize(data.isect.normal) * 0.5f + glm::vec3(0.5f);
-						else
-							return glm::vec3(0.0f);
-					}
-				case RaytracingParameters::BVH_TIME:
-				case RaytracingParameters::TIME: {
- 					Timer timer;
- 					timer.start();
- 					if(context.params.render_mode == RaytracingParameters::TIME) {
- 					    auto const color = render_pixel(x, y, ctx, data);
- 					    (void) color;
- 					}
-					else {
-						Ray ray = createPrimaryRay(data, float(x) + 0.5f, float(y) + 0.5f);
-						for(auto& o: context.get_active_scene()->objects) {
-							BVH *bvh = dynamic_cast<BVH *>(o.get());
-							if(bvh) {
-								bvh->intersect(ray, nullptr);
-							}
-						}
-					}
-					timer.stop();
-					return heatmap(static_cast<float>(timer.getElapsedTimeInMilliSec()) * context.params.scale_render_time);
-				}
-				case RaytracingParameters::DUDV: {
-					auto const color = render_pixel(x, y, ctx, data);
-					(void) color;
-					if(!data.isect.isValid())
-						return glm::vec3(0.0);
-					return heatmap(std::log(1.0f + 5.0f * glm::length(data.isect.dudv)));
-				}
-				case RaytracingParameters::AABB_INTERSECT_COUNT: {
-					Ray ray = createPrimaryRay(data, float(x) + 0.5f, float(y) + 0.5f);
-					glm::vec3 accum(0.0f);
-					for(auto& o: context.get_active_scene()->objects) {
-						auto *bvh = dynamic_cast<BVH *>(o.get());
-						if(bvh) {
-							accum += bvh->intersect_count(ray, 0, 0) * 0.02f;
-						}
-					}
-					return accum;
+template <int Mode>
+glm::vec3 HostRender::render_pixel_in_mode(LaunchState const& state, int x, int y, ThreadLocalData* tld)
+{
+	RaytracingContext const& context = *state.context;
+	PixelCall const& render_pixel = state.render_pixel;
+	RenderData data(context, tld);
+	data.progressive_pass = state.pass;
+	switch(Mode) {
+
+		case DISPLAY_TEXTURE: {
+			float u = float(x)/context.params.image_width;
+			float v = float(y)/context.params.image_height;
+			float a = state.display_aspect;
+			return glm::vec3(state.display_texture->evaluate_bilinear(0, a > 1.0
+					? glm::vec2(u, v * a - (a - 1.0f) * 0.5f)
+					: glm::vec2(u / a - (1.0f - a) * 0.5f, v)));
+		}
+
+		case RaytracingParameters::RECURSIVE:
+		case RaytracingParameters::SAMPLE_COUNT:
+			if (context.params.stereo)
+			{
+				glm::vec3 left, right;
+				render_stereo_pixel(render_pixel, x, y, context, data, &left, &right);
+				return combine_stereo(left, right);
+			}
+			else
+			{
+				return render_pixel(x, y, context, data);
+			}
+
+		case RaytracingParameters::DESATURATE:
+			if (context.params.stereo)
+			{
+				glm::vec3 left, right;
+				render_stereo_pixel(render_pixel, x, y, context, data, &left, &right);
+				return combine_stereo(desaturate(left), desaturate(right));
+			}
+			else
+			{
+				return desaturate(render_pixel(x, y, context, data));
+			}
+
+		case RaytracingParameters::NUM_RAYS:
+			render_pixel(x, y, context, data);
+			return heatmap(float(data.num_cast_rays - 1) / 64.0f);
+		case RaytracingParameters::NORMAL:
+			render_pixel(x, y, context, data);
+			if (context.params.normal_mapping)
+				return glm::normalize(data.isect.shading_normal) * 0.5f + glm::vec3(0.5f);
+			else
+			{
+				if (data.isect.isValid())
+					return glm::normalize(data.isect.normal) * 0.5f + glm::vec3(0.5f);
+				else
+					return glm::vec3(0.0f);
+			}
+		case RaytracingParameters::BVH_TIME:
+		case RaytracingParameters::TIME: {
+			Timer timer;
+			timer.start();
+			if(Mode == RaytracingParameters::TIME) {
+			    auto const color = render_pixel(x, y, context, data);
+			    (void) color;
+			}
+			else {
+				Ray ray = createPrimaryRay(data, float(x) + 0.5f, float(y) + 0.5f);
+				for(BVH* bvh: state.bvhs) {
+					HitRecord hit;
+					bvh->intersect(ray, &hit);
 				}
-				default: /* should never happen */
-				return glm::vec3(1, 0, 1);
 			}
-		};
+			timer.stop();
+			return heatmap(static_cast<float>(timer.getElapsedTimeInMilliSec()) * context.params.scale_render_time);
+		}
+		case RaytracingParameters::DUDV: {
+			auto const color = render_pixel(x, y, context, data);
+			(void) color;
+			if(!data.isect.isValid())
+				return glm::vec3(0.0);
+			return heatmap(std::log(1.0f + 5.0f * glm::length(data.isect.dudv)));
+		}
+		case RaytracingParameters::AABB_INTERSECT_COUNT: {
+			Ray ray = createPrimaryRay(data, float(x) + 0.5f, float(y) + 0.5f);
+			glm::vec3 accum(0.0f);
+			for(BVH* bvh: state.bvhs) {
+				accum += bvh->intersect_count(ray, 0, 0) * 0.02f;
+			}
+			return accum;
+		}
+		default: /* should never happen */
+		return glm::vec3(1, 0, 1);
+	}
+}
 
-	if (context.params.interactive)
+template <int Mode>
+void HostRender::render_tile_per_pixel(LaunchState const& state, Tile const& tile)
+{
+	for (int y = tile.y0; y < tile.y1; y++) 
 	{
-		return run_interactive(context, render_pixel_wrapper, render_overlay);
+		for (int x = tile.x0; x < tile.x1; x++) 
+		{
+			if (tile.terminated())
+				return;
+
+			if (!tile.needs_sample(state.context->params, x, y))
+				continue;
+
+			glm::vec3 const color = render_pixel_in_mode<Mode>(state, x, y, tile.tld);
+			tile.pixel(x, y) = glm::vec4(color, 1.f);
+		}
 	}
-	else
+}
+
+void HostRender::render_tile(LaunchState const& state, Tile const& tile)
+{
+	state.render_tile(*state.context, tile);
+}
+
+/*
+ * Renders the color like the RECURSIVE mode and writes the AOVs of the
+ * same sample.
+ */
+void HostRender::render_tile_aovs(LaunchState const& state, Tile const& tile)
+{
+	RaytracingContext const& context = *state.context;
+	for (int y = tile.y0; y < tile.y1; y++) 
 	{
-		return run_noninteractive(context, render_pixel_wrapper, 
-				kill_timeout_seconds);
+		for (int x = tile.x0; x < tile.x1; x++) 
+		{
+			if (tile.terminated())
+				return;
+
+			if (!tile.needs_sample(context.params, x, y))
+				continue;
+
+			RenderData data(context, tile.tld);
+			data.progressive_pass = state.pass;
+			Timer timer;
+			timer.start();
+			glm::vec3 const color = state.render_pixel(x, y, context, data);
+			timer.stop();
+
+			tile.pixel(x, y) = glm::vec4(color, 1.f);
+			tile.aovs->add_sample(x, y, data.isect, context.params.normal_mapping,
+				data.num_cast_rays, static_cast<float>(timer.getElapsedTimeInMilliSec()));
+		}
+	}
+}
+
+HostRender::TileKernel HostRender::select_tile_kernel(LaunchState const& state)
+{
+	if (state.render_tile)
+		return &render_tile;
+	if (state.display_texture)
+		return &render_tile_per_pixel<DISPLAY_TEXTURE>;
+	if (state.aovs)
+		return &render_tile_aovs;
+
+	switch(state.context->params.render_mode) {
+		case RaytracingParameters::RECURSIVE:            return &render_tile_per_pixel<RaytracingParameters::RECURSIVE>;
+		case RaytracingParameters::DESATURATE:           return &render_tile_per_pixel<RaytracingParameters::DESATURATE>;
+		case RaytracingParameters::NUM_RAYS:             return &render_tile_per_pixel<RaytracingParameters::NUM_RAYS>;
+		case RaytracingParameters::NORMAL:               return &render_tile_per_pixel<RaytracingParameters::NORMAL>;
+		case RaytracingParameters::TIME:                 return &render_tile_per_pixel<RaytracingParameters::TIME>;
+		case RaytracingParameters::DUDV:                 return &render_tile_per_pixel<RaytracingParameters::DUDV>;
+		case RaytracingParameters::BVH_TIME:             return &render_tile_per_pixel<RaytracingParameters::BVH_TIME>;
+		case RaytracingParameters::AABB_INTERSECT_COUNT: return &render_tile_per_pixel<RaytracingParameters::AABB_INTERSECT_COUNT>;
+		case RaytracingParameters::SAMPLE_COUNT:         return &render_tile_per_pixel<RaytracingParameters::SAMPLE_COUNT>;
+		default: /* should never happen */
+		return &render_tile_per_pixel<RaytracingParameters::RENDER_MODE_COUNT + 1>;
 	}
 }
 
@@ -154,41 +333,145 @@ void HostRender::generate_tile_idx(int num_tiles_x, int num_tiles_y, std::vector
 
 // -----------------------------------------------------------------------------
 
+bool HostRender::needs_sample(AccumulationBuffer const& accum, RaytracingParameters const& params, int x, int y)
+{
+	if (!params.adaptive_sampling)
+		return true;
+
+	int const n = accum.get_num_samples(x, y);
+	if (n < params.adaptive_min_spp)
+		return true;
+	if (n >= params.adaptive_max_spp)
+		return false;
+	return accum.get_relative_error(x, y) > params.adaptive_threshold;
+}
+
+// -----------------------------------------------------------------------------
+
+bool HostRender::continue_passes(AccumulationBuffer const& accum, long long samples_before_pass,
+		RaytracingParameters const& params, int pass)
+{
+	if (!params.adaptive_sampling)
+		return pass + 1 < params.max_progressive_passes;
+
+	long long const budget = (long long)(params.adaptive_budget_spp)
+		* accum.getWidth() * accum.getHeight();
+
+	// Stop once the budget is spent or all pixels are below the threshold.
+	return accum.get_total_samples() > samples_before_pass
+		&& accum.get_total_samples() < budget;
+}
+
+// -----------------------------------------------------------------------------
+
 int HostRender::run_noninteractive(RaytracingContext& context, 
-		PixelFuncRaw const& render_pixel, int kill_timeout_seconds)
+		RenderFunc const& render_func, int kill_timeout_seconds)
 {
 	Image      frame_buffer(context.params.image_width, context.params.image_height);
 	ThreadPool thread_pool(context.params.num_threads);
 	std::vector<glm::ivec2> tile_idx;
 
+	auto wait_for_render = [&]()
+	{
+		if (kill_timeout_seconds > 0)
+		{
+			if (thread_pool.kill_at_timeout(kill_timeout_seconds))
+			{
+				cg_assert(!bool("Process ran into timeout - is there an infinite "
+							"loop?"));
+			}
+		}
+		else
+		{
+			thread_pool.wait();
+		}
+		thread_pool.poll_exceptions();
+	};
+
+	unsigned aov_mask = 0;
+	if (!AOVBuffers::parse(context.params.aovs, &aov_mask))
+	{
+		return 1;
+	}
+	if (aov_mask && context.params.stereo)
+	{
+		// the AOVs hold one sample per pixel, not one per eye
+		std::cerr << "AOVs are not supported in stereo mode" << std::endl;
+		return 1;
+	}
+	if (aov_mask && context.params.render_mode != RaytracingParameters::RECURSIVE)
+	{
+		// render_tile_aovs renders the color like the RECURSIVE mode
+		std::cerr << "AOVs are only supported in the recursive render mode" << std::endl;
+		return 1;
+	}
+	std::unique_ptr<AOVBuffers> aovs;
+	if (aov_mask)
+	{
+		aovs.reset(new AOVBuffers(context.params.image_width, context.params.image_height, aov_mask));
+	}
+
 	Timer timer;
 	timer.start();
+	ShadowCache::reset_stats();
 	context.get_active_scene()->refresh_scene(context.params);
-	launch(&frame_buffer, thread_pool, &context, &tile_idx, render_pixel);
-
-	if (kill_timeout_seconds > 0)
+	context.get_active_scene()->compile_materials();
+	context.get_active_scene()->build_light_bvh();
+	if (context.params.adaptive_sampling)
 	{
-		if (thread_pool.kill_at_timeout(kill_timeout_seconds))
+		AccumulationBuffer accum_buffer(context.params.image_width, context.params.image_height);
+		for (int pass = 0; ; ++pass)
 		{
-			cg_assert(!bool("Process ran into timeout - is there an infinite "
-						"loop?"));
+			long long const samples_before_pass = accum_buffer.get_total_samples();
+			launch(&frame_buffer, thread_pool, &context, &tile_idx, render_func, &accum_buffer, pass, aovs.get());
+			wait_for_render();
+			if (!continue_passes(accum_buffer, samples_before_pass, context.params, pass))
+				break;
 		}
+		std::cout << "Adaptive sampling: "
+			<< double(accum_buffer.get_total_samples()) / double(context.params.image_width * context.params.image_height)
+			<< " samples per pixel" << std::endl;
 	}
 	else
 	{
-		thread_pool.wait();
+		launch(&frame_buffer, thread_pool, &context, &tile_idx, render_func, nullptr, -1, aovs.get());
+		wait_for_render();
 	}
-	thread_pool.poll_exceptions();
 	timer.stop();
 	std::cout << "Rendering time: " << timer.getElapsedTimeInMilliSec() << "ms" << std::endl;
+	if (ShadowCache::total_lookups() > 0)
+	{
+		std::cout << "Shadow cache: " << ShadowCache::total_hits() << " of "
+			<< ShadowCache::total_lookups() << " shadow rays blocked by the cached occluder ("
+			<< 100.0 * double(ShadowCache::total_hits()) / double(ShadowCache::total_lookups())
+			<< "%)" << std::endl;
+	}
+	if (PageCache::enabled())
+	{
+		const PageCache::Stats stats = PageCache::get_stats();
+		std::cout << "Texture pages: " << stats.hits << " hits, " << stats.misses << " misses, "
+			<< stats.evictions << " evictions, peak "
+			<< double(stats.peak_resident_bytes) / double(1 << 20) << " of "
+			<< double(PageCache::get_budget()) / double(1 << 20) << " MB resident" << std::endl;
+	}
 	frame_buffer.save(context.params.output_file_name.c_str(), 2.2f);
 
+	if (aovs)
+	{
+		aovs->set_color(frame_buffer);
+		if (!aovs->save(context.params.aov_file_name))
+		{
+			std::cerr << "could not write AOVs to \"" << context.params.aov_file_name << "\"" << std::endl;
+			return 1;
+		}
+	}
+
 	return 0;
 }
 
 // -----------------------------------------------------------------------------
 
-int HostRender::run_interactive(RaytracingContext& context, PixelFuncRaw const& render_pixel,
+int HostRender::run_interactive(RaytracingContext& context, RenderFunc const& render_func,
 		std::function<void()> const& render_overlay)
 {
 	Image      frame_buffer(context.params.image_width, context.params.image_height);
@@ -200,11 +483,17 @@ int HostRender::run_interactive(RaytracingContext& context, PixelFuncRaw const&
 		return 1;
 	}
 
-	if(context.get_active_scene())
+	if(context.get_active_scene()) {
 		context.get_active_scene()->set_active_camera();
+		context.get_active_scene()->compile_materials();
+		context.get_active_scene()->build_light_bvh();
+	}
 
 	// Launch first render.
-	launch(&frame_buffer, thread_pool, &context, &tile_idx, render_pixel);
+	AccumulationBuffer accum_buffer(context.params.image_width, context.params.image_height);
+	long long samples_before_pass = 0;
+	int pass = renders_in_passes(context.params) ? 0 : -1;
+	launch(&frame_buffer, thread_pool, &context, &tile_idx, render_func, &accum_buffer, pass);
 
 	auto time_last_frame = std::chrono::high_resolution_clock::now();
 
@@ -217,13 +506,10 @@ int HostRender::run_interactive(RaytracingContext& context, PixelFuncRaw const&
 
 		// Restart rendering if parameters have changed.
 		auto cam = Camera::get_active();
-		if (cam && cam->requires_restart())
+		bool const camera_changed = cam && cam->requires_restart();
+		if (camera_changed)
 			update_flags |= GUI::FLAG_REDRAW;
 
-		if(update_flags) {
-			thread_pool.terminate();
-		}
-
 		if(update_flags)
 		{
 			if (oldParams.eye_separation != context.params.eye_separation)
@@ -234,14 +520,6 @@ int HostRender::run_interactive(RaytracingContext& context, PixelFuncRaw const&
 			{
 				cam->set_focal_distance(context.params.focal_distance);
 			}
-			if (update_flags & GUI::FLAG_REFRESH_SCENE)
-			{
-					// reload scene
-				if(context.get_active_scene()) {
-					context.get_active_scene()->set_active_camera();
-					context.get_active_scene()->refresh_scene(context.params);
-				}
-			}
 			if(context.params.spp < oldParams.spp)
 			{
 				while(int(sqrtf(static_cast<float>(context.params.spp))) * int(sqrtf(static_cast<float>(context.params.spp))) != context.params.spp
@@ -257,10 +535,40 @@ int HostRender::run_interactive(RaytracingContext& context, PixelFuncRaw const&
 					context.params.spp++;
 				}
 			}
+
+			// In progressive mode, keep accumulating unless the image changes.
+			bool const restart = !renders_in_passes(context.params)
+				|| camera_changed
+				|| (update_flags & GUI::FLAG_REFRESH_SCENE)
+				|| context.params.change_requires_restart(oldParams);
+
+			if (restart)
+			{
+				thread_pool.terminate();
+				if (update_flags & GUI::FLAG_REFRESH_SCENE)
+				{
+						// reload scene
+					if(context.get_active_scene()) {
+						context.get_active_scene()->set_active_camera();
+						context.get_active_scene()->refresh_scene(context.params);
+						context.get_active_scene()->compile_materials();
+						context.get_active_scene()->build_light_bvh();
+					}
+				}
+				pass = renders_in_passes(context.params) ? 0 : -1;
+				samples_before_pass = 0;
+				launch(&frame_buffer, thread_pool, &context, &tile_idx, render_func, &accum_buffer, pass);
+			}
 			oldParams = context.params;
-			launch(&frame_buffer, thread_pool, &context, &tile_idx, render_pixel);
 			update_flags = 0;
 		}
+		else if (renders_in_passes(context.params) && pass >= 0 && thread_pool.done()
+				&& continue_passes(accum_buffer, samples_before_pass, context.params, pass))
+		{
+			// Camera is still, refine the image with another pass.
+			samples_before_pass = accum_buffer.get_total_samples();
+			launch(&frame_buffer, thread_pool, &context, &tile_idx, render_func, &accum_buffer, ++pass);
+		}
 
 		// Update the texture displayed online in regular intervals so that
 		// we don't waste many cycles uploading all the time.
@@ -281,18 +589,29 @@ int HostRender::run_interactive(RaytracingContext& context, PixelFuncRaw const&
 
 void HostRender::launch(Image* fb, 
 		ThreadPool& thread_pool, 
-		RaytracingContext const* context, 
+		RaytracingContext* context, 
 		std::vector<glm::ivec2>* tile_idx,
-		PixelFuncRaw render_pixel)
+		RenderFunc const& render_func,
+		AccumulationBuffer* accum,
+		int pass,
+		AOVBuffers* aovs)
 {
 	if (!thread_pool.enough_progress())
 	{
 		//return;
 	}
 
-	// Clean up.
+	// Clean up. Progressive passes after the first one refine the image.
 	thread_pool.terminate();
-	fb->clear(glm::vec4(0.f));
+	if (pass <= 0)
+	{
+		fb->clear(glm::vec4(0.f));
+		if (accum && pass == 0)
+			accum->clear();
+	}
+
+	// The feature toggles do not change while the threads are running.
+	context->shading_kernels = &select_shading_kernels(context->params);
 
 	// Compute number of tiles (work units).
 	int const width  = fb->getWidth();
@@ -305,37 +624,90 @@ void HostRender::launch(Image* fb,
 	// New tile indices.
 	generate_tile_idx(num_tiles_x, num_tiles_y, tile_idx);
 
+	// Resolve the scene and the render mode once for all tiles.
+	LaunchState state;
+	state.context = context;
+	if (render_func.pixel)
+		state.render_pixel = PixelCall(render_func.pixel);
+	state.render_tile = render_func.tile;
+	state.pass = pass;
+	state.aovs = aovs;
+	if (state.render_pixel)
+	{
+		Scene* scene = context->get_active_scene();
+		state.display_texture = scene->get_display_texture(context->params);
+		if (state.display_texture)
+		{
+			auto const& mip = state.display_texture->get_mip_levels()[0];
+			state.display_aspect = float(mip->getWidth()) / float(mip->getHeight());
+		}
+		for (auto& o : scene->objects)
+		{
+			if (BVH* bvh = dynamic_cast<BVH*>(o.get()))
+				state.bvhs.push_back(bvh);
+		}
+	}
+	TileKernel const render_tile_kernel = select_tile_kernel(state);
+
 	// Launch threads.
 	thread_pool.run<ThreadLocalData>(num_tiles, 
 			// The actual kernel.
 			[=](int tile, ThreadLocalData* tld, std::atomic<bool>& terminate)
 			{
 				glm::ivec2 const idx = (*tile_idx)[tile];
+
+				// Every pass needs different random numbers, otherwise
+				// the accumulated samples would be identical.
+				if (pass >= 0)
+				{
+					tld->rng.seed(8890u + std::uint32_t(pass) * std::uint32_t(num_tiles) + std::uint32_t(tile));
+				}
+
 				int const baseX = std::max<int>(idx[0] * tile_size, 0);
 				int const endX  = std::min<int>(baseX + tile_size, width);
 
 				int const baseY = std::max<int>(idx[1] * tile_size, 0);
 				int const endY  = std::min<int>(baseY + tile_size, height);
 
+				bool const accumulate = accum && pass >= 0;
+
+				// The alpha channel marks pixels that were rendered in this
+				// launch, adaptive sampling skips converged pixels.
 				Image img(endX-baseX, endY-baseY);
-				for (int y = baseY; y < endY; y++) 
-				{
-					for (int x = baseX; x < endX; x++) 
-					{
-						if (terminate.load())
-							return;
+				img.clear(glm::vec4(0.f));
 
-						glm::vec3 const color = render_pixel(x, y, *context, dynamic_cast<ThreadLocalData*>(tld));
-						img.setPixel(x-baseX, y-baseY, glm::vec4(color, 1.f));
-					}
-				}
+				Tile const t = { baseX, baseY, endX, endY, img.getPixels(), tld, pass,
+					accumulate ? accum : nullptr, &terminate, aovs };
+				render_tile_kernel(state, t);
+				tld->shadow_cache.flush_stats();
+				if (terminate.load())
+					return;
 
 				std::lock_guard<std::mutex> lock(mutex);
 				for (int y = baseY; y < endY; y++) 
 				{
 					for (int x = baseX; x < endX; x++) 
 					{
-						fb->setPixel(x, y, img.getPixel(x-baseX, y-baseY));
+						if (accumulate)
+						{
+							glm::vec4 const& sample = img.getPixel(x-baseX, y-baseY);
+							if (sample.w > 0.f)
+								accum->add_sample(x, y, glm::vec3(sample));
+
+							if (context->params.render_mode == RaytracingParameters::SAMPLE_COUNT)
+							{
+								float const n = float(accum->get_num_samples(x, y));
+								fb->setPixel(x, y, glm::vec4(heatmap(n / float(std::max(1, context->params.adaptive_max_spp))), 1.f));
+							}
+							else
+							{
+								fb->setPixel(x, y, glm::vec4(accum->get_mean(x, y), 1.f));
+							}
+						}
+						else
+						{
+							fb->setPixel(x, y, img.getPixel(x-baseX, y-baseY));
+						}
 					}
 				}
 
@@ -0,0 +1,128 @@
+#include <cglib/rt/light_bvh.h>
+
+#include <cglib/rt/light.h>
+#include <cglib/core/assert.h>
+
+#include <algorithm>
+#include <cmath>
+
+void LightBVH::
+build(std::vector<std::unique_ptr<Light>> const& lights)
+{
+	nodes.clear();
+
+	std::vector<BuildLight> build_lights;
+	build_lights.reserve(lights.size());
+	for (size_t i = 0; i < lights.size(); ++i) {
+		cg_assert(lights[i]);
+		const glm::vec3 power = lights[i]->getPower();
+		const float p = std::max(power.x, std::max(power.y, power.z));
+		if (p > 0.f)
+			build_lights.push_back({ lights[i]->getPosition(), p, int(i) });
+	}
+	if (build_lights.empty())
+		return;
+
+	nodes.reserve(2 * build_lights.size() - 1);
+	nodes.emplace_back();
+	build_recursive(0, build_lights, 0, int(build_lights.size()));
+}
+
+void LightBVH::
+build_recursive(int node_idx, std::vector<BuildLight>& lights, int begin, int end)
+{
+	cg_assert(begin < end);
+
+	AABB aabb;
+	float power = 0.f;
+	for (int i = begin; i < end; ++i) {
+		aabb.extend(lights[i].position);
+		power += lights[i].power;
+	}
+	nodes[node_idx].aabb = aabb;
+	nodes[node_idx].power = power;
+
+	if (end - begin == 1) {
+		nodes[node_idx].light = lights[begin].index;
+		return;
+	}
+
+	// split at the median along the largest extent
+	const glm::vec3 extent = aabb.max - aabb.min;
+	const int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+	const int mid = (begin + end) / 2;
+	std::nth_element(lights.begin() + begin, lights.begin() + mid, lights.begin() + end,
+		[axis](BuildLight const& a, BuildLight const& b) { return a.position[axis] < b.position[axis]; });
+
+	const int left = int(nodes.size());
+	nodes[node_idx].left = left;
+	nodes.emplace_back();
+	nodes.emplace_back();
+	build_recursive(left,     lights, begin, mid);
+	build_recursive(left + 1, lights, mid,   end);
+}
+
+float LightBVH::
+importance(Node const& node, glm::vec3 const& P, glm::vec3 const& N, bool two_sided) const
+{
+	const glm::vec3 center = 0.5f * (node.aabb.min + node.aabb.max);
+	const glm::vec3 half_extent = 0.5f * (node.aabb.max - node.aabb.min);
+	const float radius2 = glm::dot(half_extent, half_extent);
+	const glm::vec3 d = center - P;
+	const float d2 = glm::dot(d, d);
+
+	// inside the bounding sphere, any direction may lead to a light
+	if (d2 <= radius2)
+		return node.power / radius2;
+
+	float cos_bound = 1.f;
+	if (!two_sided) {
+		// cos(max(0, theta_i - theta_u)), theta_i is the angle between N and
+		// the direction to the center, theta_u the half angle of the
+		// cone around it that contains the bounding sphere
+		const float dist = std::sqrt(d2);
+		const float cos_i = glm::dot(N, d) / dist;
+		const float sin_u2 = radius2 / d2;
+		const float cos_u = std::sqrt(1.f - sin_u2);
+		if (cos_i < cos_u) {
+			const float sin_i = std::sqrt(std::max(0.f, 1.f - cos_i * cos_i));
+			cos_bound = std::max(0.f, cos_i * cos_u + sin_i * std::sqrt(sin_u2));
+		}
+	}
+
+	return node.power * cos_bound / d2;
+}
+
+int LightBVH::
+sample(glm::vec3 const& P, glm::vec3 const& N, bool two_sided, float u, float* pdf) const
+{
+	cg_assert(pdf);
+	if (nodes.empty())
+		return -1;
+
+	float p = 1.f;
+	int idx = 0;
+	while (nodes[idx].light < 0) {
+		Node const& n = nodes[idx];
+		const float w_left  = importance(nodes[n.left],     P, N, two_sided);
+		const float w_right = importance(nodes[n.left + 1], P, N, two_sided);
+		if (!(w_left + w_right > 0.f))
+			return -1;
+
+		// reuse u for the next level by rescaling it to [0, 1)
+		const float p_left = w_left / (w_left + w_right);
+		if (u < p_left) {
+			u = std::min(u / p_left, 1.f - 1e-7f);
+			p *= p_left;
+			idx = n.left;
+		}
+		else {
+			u = std::min((u - p_left) / (1.f - p_left), 1.f - 1e-7f);
+			p *= 1.f - p_left;
+			idx = n.left + 1;
+		}
+	}
+
+	*pdf = p;
+	return nodes[idx].light;
+}
@@ -1,21 +1,34 @@
 #include <cglib/rt/material.h>
 #include <cglib/rt/intersection.h>
+#include <cglib/rt/raytracing_parameters.h>
 
-void MaterialSample::
-evaluate(
-	Material const& material, 
-	Intersection const& isect)
+unsigned MaterialSample::
+required_flags(RaytracingParameters const& params)
 {
-	k_d    = glm::vec3(material.k_d->evaluate(isect.uv, isect.dudv));
-	k_s    = glm::vec3(material.k_s->evaluate(isect.uv, isect.dudv));
-	k_r    = glm::vec3(material.k_r->evaluate(isect.uv, isect.dudv));
-	k_t    = glm::vec3(material.k_t->evaluate(isect.uv, isect.dudv));
-	normal = glm::vec3(material.normal->evaluate(isect.uv, isect.dudv));
-	normal = glm::normalize(glm::vec3(2.f*normal[0]-1.f, normal[2], 2.f*normal[1]-1.f));
+	unsigned flags = 0;
+	// these modes only display geometric information, diffuse white
+	// mode replaces all reflectances
+	if (params.render_mode != RaytracingParameters::NORMAL
+	 && params.render_mode != RaytracingParameters::DUDV
+	 && !params.diffuse_white_mode) {
+		flags |= EVALUATE_REFLECTANCE;
+	}
+	if (params.normal_mapping) {
+		flags |= EVALUATE_NORMAL_MAP;
+	}
+	return flags;
+}
+
+glm::vec3 MaterialSample::
+decode_normal(glm::vec3 const& texel)
+{
+	return glm::normalize(glm::vec3(2.f*texel[0]-1.f, texel[2], 2.f*texel[1]-1.f));
+}
 
+void MaterialSample::
+normalize()
+{
 	k_a = 0.1f * k_d; // simple ambient term
-	eta = material.eta;
-	n = material.n;
 
 	auto sum = k_s + k_d + k_r + k_t + k_a;
 	for (int i = 0; i < 3; ++i)
@@ -28,5 +41,33 @@ evaluate(
 			k_a[i] /= sum[i];
 		}
 	}
+}
 
+void MaterialSample::
+evaluate(
+	Material const& material, 
+	Intersection const& isect,
+	unsigned flags)
+{
+	if (flags & EVALUATE_NORMAL_MAP) {
+		normal = decode_normal(glm::vec3(material.normal->evaluate(isect.uv, isect.dudv)));
+	}
+	else {
+		normal = glm::vec3(0.f, 1.f, 0.f);
+	}
+
+	eta = material.eta;
+	n = material.n;
+
+	if (!(flags & EVALUATE_REFLECTANCE)) {
+		k_d = k_s = k_r = k_t = k_a = glm::vec3(0.f);
+		return;
+	}
+
+	// all reflectances are needed for the normalization
+	k_d    = glm::vec3(material.k_d->evaluate(isect.uv, isect.dudv));
+	k_s    = glm::vec3(material.k_s->evaluate(isect.uv, isect.dudv));
+	k_r    = glm::vec3(material.k_r->evaluate(isect.uv, isect.dudv));
+	k_t    = glm::vec3(material.k_t->evaluate(isect.uv, isect.dudv));
+	normalize();
 }
@@ -0,0 +1,123 @@
+#include <cglib/rt/material_table.h>
+#include <cglib/rt/intersection.h>
+#include <cglib/rt/texture.h>
+
+#include <cglib/core/assert.h>
+
+void MaterialTable::
+clear()
+{
+	materials.clear();
+	images.clear();
+	generic_textures.clear();
+	texture_indices.clear();
+}
+
+MaterialTable::Channel MaterialTable::
+compile_channel(std::shared_ptr<Texture> const& texture)
+{
+	cg_assert(texture);
+	Channel channel;
+
+	glm::vec4 value;
+	if (texture->is_constant(&value)) {
+		channel.type = Channel::CONSTANT;
+		channel.value = glm::vec3(value);
+		return channel;
+	}
+
+	ImageTexture const* image = dynamic_cast<ImageTexture const*>(texture.get());
+	channel.type = image ? Channel::IMAGE : Channel::GENERIC;
+
+	auto it = texture_indices.find(texture.get());
+	if (it != texture_indices.end()) {
+		channel.texture = it->second;
+		return channel;
+	}
+
+	if (image) {
+		channel.texture = int32_t(images.size());
+		images.push_back(image);
+	}
+	else {
+		channel.texture = int32_t(generic_textures.size());
+		generic_textures.push_back(texture.get());
+	}
+	texture_indices[texture.get()] = channel.texture;
+	return channel;
+}
+
+int MaterialTable::
+add(Material const& material)
+{
+	CompiledMaterial compiled;
+	compiled.k_d    = compile_channel(material.k_d);
+	compiled.k_s    = compile_channel(material.k_s);
+	compiled.k_r    = compile_channel(material.k_r);
+	compiled.k_t    = compile_channel(material.k_t);
+	compiled.normal = compile_channel(material.normal);
+	compiled.eta    = material.eta;
+	compiled.n      = material.n;
+
+	materials.push_back(compiled);
+	return int(materials.size()) - 1;
+}
+
+MaterialTable::CompiledMaterial const& MaterialTable::
+get(int idx) const
+{
+	cg_assert(idx >= 0 && idx < size());
+	return materials[idx];
+}
+
+inline glm::vec3 MaterialTable::
+evaluate_channel(Channel const& channel, Intersection const& isect) const
+{
+	switch (channel.type) {
+	case Channel::IMAGE:
+		return glm::vec3(images[channel.texture]->evaluate(isect.uv, isect.dudv));
+	case Channel::GENERIC:
+		return glm::vec3(generic_textures[channel.texture]->evaluate(isect.uv, isect.dudv));
+	default:
+		return channel.value;
+	}
+}
+
+void MaterialTable::
+evaluate(int idx, Intersection const& isect, unsigned flags, MaterialSample* sample) const
+{
+	cg_assert(sample);
+	CompiledMaterial const& material = get(idx);
+
+	sample->normal = (flags & MaterialSample::EVALUATE_NORMAL_MAP)
+		? MaterialSample::decode_normal(evaluate_channel(material.normal, isect))
+		: glm::vec3(0.f, 1.f, 0.f);
+	sample->eta = material.eta;
+	sample->n = material.n;
+
+	if (!(flags & MaterialSample::EVALUATE_REFLECTANCE)) {
+		sample->k_d = sample->k_s = sample->k_r = sample->k_t = sample->k_a = glm::vec3(0.f);
+		return;
+	}
+
+	// the image channels are looked up in one batch
+	Channel const* channels[4] = { &material.k_d, &material.k_s, &material.k_r, &material.k_t };
+	glm::vec3* values[4] = { &sample->k_d, &sample->k_s, &sample->k_r, &sample->k_t };
+	ImageTexture const* batch[4];
+	glm::vec4 batch_values[4];
+	int batch_channels[4];
+	int batch_size = 0;
+	for (int c = 0; c < 4; ++c) {
+		if (channels[c]->type == Channel::IMAGE) {
+			batch[batch_size] = images[channels[c]->texture];
+			batch_channels[batch_size++] = c;
+		}
+		else {
+			*values[c] = evaluate_channel(*channels[c], isect);
+		}
+	}
+	ImageTexture::evaluate(batch_size, batch, isect.uv, isect.dudv, batch_values);
+	for (int i = 0; i < batch_size; ++i)
+		*values[batch_channels[i]] = glm::vec3(batch_values[i]);
+	sample->normalize();
+}
@@ -1,5 +1,6 @@
 #include <cglib/rt/object.h>
 #include <cglib/rt/raytracing_context.h>
+#include <cglib/rt/scene.h>
 
 Object::Object() :
 	material(new Material()),
@@ -9,14 +10,65 @@ Object::Object() :
 }
 
 bool Object::
-intersect(Ray const& ray, Intersection* isect) const
+intersect(Ray const& ray, HitRecord* hit) const
 {
+	cg_assert(hit);
 	// transform ray in object space
 	const Ray ray_local = transform_ray(ray, transform_world_to_object);
+	float t_local;
+	if (geo->intersect(ray_local, &t_local)) {
+		const glm::vec3 position = transform_position(transform_object_to_world,
+			ray_local.origin + t_local * ray_local.direction);
+		hit->t = glm::length(ray.origin-position);
+		return true;
+	}
+	return false;
+}
+
+unsigned Object::
+intersect_pair(Ray const rays[2], HitRecord hits[2]) const
+{
+	unsigned found = 0;
+	for (int i = 0; i < 2; ++i) {
+		if (intersect(rays[i], &hits[i]))
+			found |= 1u << i;
+	}
+	return found;
+}
+
+bool Object::
+occluded(Ray const& ray, float t_max, HitRecord* hit) const
+{
+	return intersect(ray, hit) && hit->t < t_max;
+}
+
+bool Object::
+intersect_primitive(Ray const& ray, uint32_t primitive_id, HitRecord* hit) const
+{
+	return intersect(ray, hit);
+}
+
+void Object::
+fill_intersection(Ray const& ray, HitRecord const& hit, Intersection* isect) const
+{
+	cg_assert(isect);
+	// intersecting the analytic shape again is cheaper than carrying
+	// the full intersection through the traversal
+	const Ray ray_local = transform_ray(ray, transform_world_to_object);
 	Intersection isect_local;
-	if (geo->intersect(ray_local, &isect_local)) {
-		*isect = transform_intersection(isect_local, transform_object_to_world, transform_object_to_world_normal);
-		isect->t = glm::length(ray.origin-isect->position);
+	geo->intersect(ray_local, &isect_local);
+	*isect = transform_intersection(isect_local, transform_object_to_world, transform_object_to_world_normal);
+	isect->t = hit.t;
+}
+
+bool Object::
+intersect(Ray const& ray, Intersection* isect) const
+{
+	HitRecord hit;
+	if (intersect(ray, &hit)) {
+		if (isect) {
+			fill_intersection(ray, hit, isect);
+		}
 		return true;
 	}
 	return false;
@@ -32,7 +84,7 @@ compute_shading_info(Intersection* isect)
 		texture_mapping->compute_tangent_space(&isect_local);
 
 		isect_local.uv = get_uv(isect_local);
-		isect_local.material.evaluate(*material, isect_local);
+		evaluate_material(&isect_local);
 		isect_local.shading_normal = transform_direction_to_object_space(isect_local.material.normal,
 			isect_local.normal, isect_local.tangent, isect_local.bitangent);
 
@@ -42,7 +94,7 @@ compute_shading_info(Intersection* isect)
 	{
 		texture_mapping->compute_tangent_space(isect);
 		isect->uv = get_uv(*isect);
-		isect->material.evaluate(*material, *isect);
+		evaluate_material(isect);
 		isect->shading_normal = transform_direction_to_object_space(isect->material.normal,
 			isect->normal, isect->tangent, isect->bitangent);
 	}
@@ -63,7 +115,7 @@ compute_shading_info(const Ray rays[4], Intersection* isect)
 			rays_local[i] = transform_ray(rays[i], transform_world_to_object);
 		}
 		isect_local.dudv = compute_uv_aabb_size(rays_local, isect_local);
-		isect_local.material.evaluate(*material, isect_local);
+		evaluate_material(&isect_local);
 		isect_local.shading_normal = transform_direction_to_object_space(isect_local.material.normal,
 			isect_local.normal, isect_local.tangent, isect_local.bitangent);
 
@@ -74,12 +126,26 @@ compute_shading_info(const Ray rays[4], Intersection* isect)
 		texture_mapping->compute_tangent_space(isect);
 		isect->uv = get_uv(*isect);
 		isect->dudv = compute_uv_aabb_size(rays, *isect);
-		isect->material.evaluate(*material, *isect);
+		evaluate_material(isect);
 		isect->shading_normal = transform_direction_to_object_space(isect->material.normal,
 			isect->normal, isect->tangent, isect->bitangent);
 	}
 }
 
+void Object::
+evaluate_material(Intersection* isect) const
+{
+	RaytracingContext const* context = RaytracingContext::get_active();
+	const unsigned flags = MaterialSample::required_flags(context->params);
+	isect->material_id = material_index;
+	if (material_index >= 0) {
+		context->get_active_scene()->material_table.evaluate(material_index, *isect, flags, &isect->material);
+	}
+	else {
+		isect->material.evaluate(*material, *isect, flags);
+	}
+}
+
 void Object::
 get_intersection_uvs(glm::vec3 const positions[4], Intersection const& isect, glm::vec2 uvs[4])
 {
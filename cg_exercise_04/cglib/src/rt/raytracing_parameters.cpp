@@ -25,6 +25,61 @@ void RaytracingParameters::initialize()
 {
 }
 
+bool RaytracingParameters::derived_change_requires_restart(Parameters const& old_) const
+{
+	RaytracingParameters const* old = dynamic_cast<RaytracingParameters const*>(&old_);
+	if (!old)
+		return true;
+
+	// Display-only settings (exposure, gamma, fps, threads) are not listed.
+	return false
+		|| stereo             != old->stereo
+		|| eye_separation     != old->eye_separation
+		|| focal_distance     != old->focal_distance
+		|| image_width        != old->image_width
+		|| image_height       != old->image_height
+		|| active_scene       != old->active_scene
+		|| fourier_mode       != old->fourier_mode
+		|| gauss_mode         != old->gauss_mode
+		|| sigma              != old->sigma
+		|| kernel_radius      != old->kernel_radius
+		|| render_mode        != old->render_mode
+		|| diffuse_white_mode != old->diffuse_white_mode
+		|| max_depth          != old->max_depth
+		|| shadows            != old->shadows
+		|| ambient            != old->ambient
+		|| diffuse            != old->diffuse
+		|| specular           != old->specular
+		|| reflection         != old->reflection
+		|| transmission       != old->transmission
+		|| fresnel            != old->fresnel
+		|| stochastic_fresnel != old->stochastic_fresnel
+		|| dispersion         != old->dispersion
+		|| spectral_dispersion != old->spectral_dispersion
+		|| russian_roulette   != old->russian_roulette
+		|| rr_min_depth       != old->rr_min_depth
+		|| min_throughput     != old->min_throughput
+		|| scale_render_time  != old->scale_render_time
+		|| ray_epsilon        != old->ray_epsilon
+		|| fovy               != old->fovy
+		|| stratified         != old->stratified
+		|| normal_mapping     != old->normal_mapping
+		|| light_sampling     != old->light_sampling
+		|| light_samples      != old->light_samples
+		|| transform_objects  != old->transform_objects
+		|| spp                != old->spp
+		|| num_triangles      != old->num_triangles
+		|| tex_filter_mode    != old->tex_filter_mode
+		|| tex_wrap_mode      != old->tex_wrap_mode
+		|| progressive        != old->progressive
+		|| adaptive_sampling  != old->adaptive_sampling
+		|| adaptive_min_spp   != old->adaptive_min_spp
+		|| adaptive_max_spp   != old->adaptive_max_spp
+		|| adaptive_budget_spp != old->adaptive_budget_spp
+		|| adaptive_threshold != old->adaptive_threshold
+		;
+}
+
 int RaytracingParameters::display_parameters()
 {
 	bool redraw = false;
@@ -78,6 +133,7 @@ int RaytracingParameters::display_parameters()
 "du dv:                   texture coordinate gradient length\n"
 "AABB Intersection Count: Number of AABBs that could be intersected by ray\n"
 "BVH Traversal Time:      Time spent on bvh traversal for primary hit\n"
+"Adaptive Sample Count:   Samples spent on each pixel by adaptive sampling\n"
 			);
 		}
 		if (render_mode == TIME
@@ -87,11 +143,27 @@ int RaytracingParameters::display_parameters()
 			redraw |= ImGui::DragFloat("Render Time Exposure", &scale_render_time, 0.1f, 0.f, 1000.f);
 		}
 		redraw |= ImGui::InputInt("Max Recursion Depth", &max_depth);
+		redraw |= ImGui::Checkbox("Russian Roulette", &russian_roulette);
+		if (russian_roulette) {
+			redraw |= ImGui::InputInt("Russian Roulette Min Depth", &rr_min_depth);
+		}
+		redraw |= ImGui::DragFloat("Min Path Throughput", &min_throughput, 0.0001f, 0.f, 1.f, "%.5f");
 		redraw |= ImGui::DragFloat("Ray Epsilon", &ray_epsilon, 0.00001f, 0.0f, 0.f, "%.7f");
 		redraw |= ImGui::DragFloat("Field of View Y", &fovy);
 		redraw |= ImGui::InputInt("Render Threads", &num_threads);
 		redraw |= ImGui::Checkbox("Stratified Samples", &stratified);
 		redraw |= ImGui::InputInt("Pixel Samples", &spp);
+		redraw |= ImGui::Checkbox("Progressive Rendering", &progressive);
+		if (progressive) {
+			redraw |= ImGui::InputInt("Max Progressive Passes", &max_progressive_passes);
+		}
+		redraw |= ImGui::Checkbox("Adaptive Sampling", &adaptive_sampling);
+		if (adaptive_sampling) {
+			redraw |= ImGui::InputInt("Min Samples", &adaptive_min_spp);
+			redraw |= ImGui::InputInt("Max Samples", &adaptive_max_spp);
+			redraw |= ImGui::InputInt("Sample Budget (per Pixel)", &adaptive_budget_spp);
+			redraw |= ImGui::DragFloat("Error Threshold", &adaptive_threshold, 0.001f, 0.f, 1.f, "%.4f");
+		}
 		redraw |= ImGui::Checkbox("Stereo Rendering", &stereo);
 		if (stereo) {
 			redraw |= ImGui::DragFloat("Eye Separation", &eye_separation, 0.01f, 0.f, 0.f);
@@ -107,8 +179,21 @@ int RaytracingParameters::display_parameters()
 		redraw |= ImGui::Checkbox("Diffuse Lighting", &diffuse);
 		redraw |= ImGui::Checkbox("Specular Lighting", &specular);
 		redraw |= ImGui::Checkbox("Reflection", &reflection);
+		redraw |= ImGui::Checkbox("Transmission", &transmission);
+		redraw |= ImGui::Checkbox("Fresnel", &fresnel);
+		if (fresnel) {
+			redraw |= ImGui::Checkbox("Stochastic Fresnel", &stochastic_fresnel);
+		}
+		redraw |= ImGui::Checkbox("Dispersion", &dispersion);
+		if (dispersion) {
+			redraw |= ImGui::Checkbox("Spectral Dispersion", &spectral_dispersion);
+		}
 		redraw |= ImGui::Checkbox("Transform Objects", &transform_objects);
 		redraw |= ImGui::Checkbox("Normal Mapping", &normal_mapping);
+		redraw |= ImGui::Combo("Light Sampling", &light_sampling, light_sampling_names, LIGHT_SAMPLING_COUNT);
+		if (light_sampling == LIGHT_SAMPLING_BVH) {
+			redraw |= ImGui::InputInt("Light Samples", &light_samples);
+		}
 	}
 
 	if (draw_texture_settings && ImGui::CollapsingHeader("Texture Settings"))
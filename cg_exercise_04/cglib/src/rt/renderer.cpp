@@ -8,11 +8,15 @@
 #include <cglib/rt/raytracing_context.h>
 #include <cglib/rt/render_data.h>
 #include <cglib/rt/scene.h>
+#include <cglib/rt/spectrum.h>
 #include <exception>
 #include <stdexcept>
 
 #include <cglib/core/thread_local_data.h>
 
+#include <algorithm>
+#include <vector>
+
 
 glm::vec3 reflect(glm::vec3 const& v, glm::vec3 const& n)
 {
@@ -96,43 +100,126 @@ Ray createPrimaryRay(RenderData& data, float x, float y)
 bool visible(
 	RenderData &data,
 	glm::vec3 const& from,
-	glm::vec3 const& to)
+	glm::vec3 const& to,
+	int light)
 {
 	data.num_cast_rays++;
     const glm::vec3 d = glm::normalize(to-from);
     const float dist = glm::length(to-from) - 2.f*data.context.params.ray_epsilon;
     Ray ray_eps(from + data.context.params.ray_epsilon * d, d);
-    for (auto& o : data.context.get_active_scene()->objects) {
-        cg_assert(o);
-        Intersection isect;
-        if (o->intersect(ray_eps, &isect) && isect.t < dist) {
+    auto const& objects = data.context.get_active_scene()->objects;
+
+    // the primitive that blocked the last shadow ray towards this light
+    ShadowCache::Entry* cached = nullptr;
+    if (light >= 0) {
+        cached = &data.tld->shadow_cache.lookup(light);
+        HitRecord hit;
+        if (cached->object_id >= 0
+         && objects[cached->object_id]->intersect_primitive(ray_eps, cached->primitive_id, &hit)
+         && hit.t < dist) {
+            data.tld->shadow_cache.hits++;
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < objects.size(); ++i) {
+        cg_assert(objects[i]);
+        HitRecord hit;
+        if (objects[i]->occluded(ray_eps, dist, &hit)) {
+            if (cached) {
+                cached->object_id = int32_t(i);
+                cached->primitive_id = hit.primitive_id;
+            }
             return false;
         }
     }
     return true;
 }
 
-bool shoot_ray(RenderData &data, Ray const& ray, Intersection* isect)
+/*
+ * find the closest hit and compute the full intersection for it
+ */
+static Object* find_closest_intersection(RenderData &data, Ray const& ray_eps, Intersection* isect)
 {
-    Object* object = nullptr;
+    auto const& objects = data.context.get_active_scene()->objects;
+
+    HitRecord hit;
+    hit.t = isect->t;
+    for (size_t i = 0; i < objects.size(); ++i) {
+        cg_assert(objects[i]);
+        HitRecord hit_temp;
+        if (objects[i]->intersect(ray_eps, &hit_temp) && hit_temp.t < hit.t) {
+            hit = hit_temp;
+            hit.object_id = int32_t(i);
+        }
+    }
 
-    cg_assert(isect);
-    
-	Ray ray_eps(ray.origin + data.context.params.ray_epsilon * ray.direction, ray.direction);
+    if (hit.object_id < 0) {
+        return nullptr;
+    }
 
-    bool found_intersection = false;
-    for (auto& o : data.context.get_active_scene()->objects) {
-        cg_assert(o);
-        Intersection isect_temp;
-        if (o->intersect(ray_eps, &isect_temp) && isect_temp.t < isect->t) {
-            found_intersection = true;
-            object = o.get();
-            *isect = isect_temp;
+    Object* object = objects[hit.object_id].get();
+    object->fill_intersection(ray_eps, hit, isect);
+    return object;
+}
+
+/*
+ * The primary rays of both eyes of a stereo pixel, traced as a pair (see
+ * Object::intersect_pair). corner_rays holds the four corner rays of each
+ * eye for the texture footprint, or is nullptr. Returns bit e set if ray e
+ * hit something, isects[e] is its intersection.
+ */
+static unsigned shoot_stereo_rays(
+	RenderData &data,
+	Ray const rays[2],
+	const Ray* corner_rays,
+	Intersection isects[2])
+{
+    auto const& objects = data.context.get_active_scene()->objects;
+    const float eps = data.context.params.ray_epsilon;
+    const Ray rays_eps[2] = {
+        Ray(rays[0].origin + eps * rays[0].direction, rays[0].direction),
+        Ray(rays[1].origin + eps * rays[1].direction, rays[1].direction)
+    };
+
+    HitRecord hits[2];
+    hits[0].t = isects[0].t;
+    hits[1].t = isects[1].t;
+    for (size_t i = 0; i < objects.size(); ++i) {
+        cg_assert(objects[i]);
+        HitRecord hits_temp[2];
+        const unsigned found = objects[i]->intersect_pair(rays_eps, hits_temp);
+        for (int e = 0; e < 2; ++e) {
+            if ((found & (1u << e)) && hits_temp[e].t < hits[e].t) {
+                hits[e] = hits_temp[e];
+                hits[e].object_id = int32_t(i);
+            }
         }
     }
 
-    if(found_intersection) {
-        cg_assert(object);
+    unsigned found = 0;
+    for (int e = 0; e < 2; ++e) {
+        if (hits[e].object_id < 0)
+            continue;
+        Object* object = objects[hits[e].object_id].get();
+        object->fill_intersection(rays_eps[e], hits[e], &isects[e]);
+        if (corner_rays)
+            object->compute_shading_info(corner_rays + 4 * e, &isects[e]);
+        else
+            object->compute_shading_info(&isects[e]);
+        found |= 1u << e;
+    }
+    return found;
+}
+
+bool shoot_ray(RenderData &data, Ray const& ray, Intersection* isect)
+{
+    cg_assert(isect);
+    
+	Ray ray_eps(ray.origin + data.context.params.ray_epsilon * ray.direction, ray.direction);
+
+    Object* object = find_closest_intersection(data, ray_eps, isect);
+    if(object) {
         object->compute_shading_info(isect);
         return true;
     }
@@ -146,24 +233,11 @@ bool shoot_ray(
 	const Ray corner_rays[4],
 	Intersection* isect)
 {
-    Object* object = nullptr;
-
     cg_assert(isect);
     Ray ray_eps(ray.origin + data.context.params.ray_epsilon * ray.direction, ray.direction);
 
-    bool found_intersection = false;
-    for (auto& o : data.context.get_active_scene()->objects) {
-        cg_assert(o);
-        Intersection isect_temp;
-        if (o->intersect(ray_eps, &isect_temp) && isect_temp.t < isect->t) {
-            found_intersection = true;
-            object = o.get();
-            *isect = isect_temp;
-        }
-    }
-
-    if(found_intersection) {
-        cg_assert(object);
+    Object* object = find_closest_intersection(data, ray_eps, isect);
+    if(object) {
         object->compute_shading_info(corner_rays, isect);
         return true;
     }
@@ -196,7 +270,81 @@ glm::vec3 evaluate_ambient(
 	return contribution;
 }
 
-glm::vec3 evaluate_phong(
+/*
+ * Feature toggles of RaytracingParameters the shading kernels are specialized
+ * for. Disabled features are removed at compile time. These are the ones
+ * tested per light; the toggles tested once per hit are runtime branches.
+ */
+enum ShadingFeature : unsigned
+{
+	FEATURE_SHADOWS        = 1u << 0,
+	FEATURE_AMBIENT        = 1u << 1,
+	FEATURE_DIFFUSE        = 1u << 2,
+	FEATURE_SPECULAR       = 1u << 3,
+	FEATURE_COMBINATIONS   = 1u << 4
+};
+
+static unsigned shading_features(RaytracingParameters const& params)
+{
+	return (params.shadows        ? FEATURE_SHADOWS        : 0u)
+	     | (params.ambient        ? FEATURE_AMBIENT        : 0u)
+	     | (params.diffuse        ? FEATURE_DIFFUSE        : 0u)
+	     | (params.specular       ? FEATURE_SPECULAR       : 0u);
+}
+
+template <unsigned F>
+static glm::vec3 trace_recursive_kernel(RenderData & data, Ray const& ray, int depth, glm::vec3 const& throughput);
+
+/*
+ * contribution of light l to evaluate_phong
+ */
+template <unsigned F>
+static glm::vec3 evaluate_phong_light(
+	RenderData &data,			// class containing raytracing information
+	MaterialSample const& mat,	// the material at position
+	glm::vec3 const& P,			// world space position
+	glm::vec3 const& N,			// normal at the position (already normalized)
+	glm::vec3 const& V,			// view vector (already normalized)
+	size_t l)					// index of the light
+{
+	Light const* light = data.context.get_active_scene()->lights[l].get();
+	// TODO: calculate the (normalized) direction to the light
+	const glm::vec3 L = glm::normalize(light->getPosition() - P);
+
+	float visibility = 1.f;
+	if (F & FEATURE_SHADOWS) {
+		// TODO: check if light source is visible
+		if (!visible(data, P, light->getPosition(), int(l))) {
+			visibility = 0.f;
+		}
+	}
+
+	glm::vec3 diffuse(0.f);
+	if (F & FEATURE_DIFFUSE) {
+		// TODO: compute diffuse component of phong model
+		if (visibility > 0.f) {
+			diffuse = std::max(0.f, glm::dot(N, L)) * mat.k_d;
+		}
+	}
+
+	glm::vec3 specular(0.f);
+	if (F & FEATURE_SPECULAR) {
+		// TODO: compute specular component of phong model
+		if ((visibility > 0.f) && (glm::dot(L, N) > 0.f)) {
+			const glm::vec3 R = reflect(L, N);
+			specular = std::pow(std::max(0.f, glm::dot(R, V)), mat.n) * mat.k_s;
+		}
+	}
+
+	glm::vec3 ambient = (F & FEATURE_AMBIENT) ? mat.k_a : glm::vec3(0.0f);
+
+	// TODO: modify this and implement the phong model as specified on the exercise sheet
+	const float dist = glm::length(light->getPosition() - P);
+	return (visibility * (diffuse + specular) + ambient) * light->getEmission(-L) / (dist*dist);
+}
+
+template <unsigned F>
+static glm::vec3 evaluate_phong_kernel(
 	RenderData &data,			// class containing raytracing information
 	MaterialSample const& mat,	// the material at position
 	glm::vec3 const& P,			// world space position
@@ -206,67 +354,56 @@ glm::vec3 evaluate_phong(
 	cg_assert(std::fabs(glm::length(N) - 1.f) < EPSILON);
 	cg_assert(std::fabs(glm::length(V) - 1.f) < EPSILON);
 
+	Scene const* scene = data.context.get_active_scene();
+	RaytracingParameters const& params = data.context.params;
 	glm::vec3 contribution(0.f);
-	// iterate over lights and sum up their contribution
-	for (auto& light : data.context.get_active_scene()->lights) {
-		// TODO: calculate the (normalized) direction to the light
-		const glm::vec3 L = glm::normalize(light->getPosition() - P);
-
-		float visibility = 1.f;
-		if (data.context.params.shadows) {
-			// TODO: check if light source is visible
-			if (!visible(data, P, light->getPosition())) {
-				visibility = 0.f;
-			}
-		}
-
-		glm::vec3 diffuse(0.f);
-		if (data.context.params.diffuse) {
-			// TODO: compute diffuse component of phong model
-			if (visibility > 0.f) {
-				diffuse = std::max(0.f, glm::dot(N, L)) * mat.k_d;
-			}
-		}
 
-		glm::vec3 specular(0.f);
-		if (data.context.params.specular) {
-			// TODO: compute specular component of phong model
-			if ((visibility > 0.f) && (glm::dot(L, N) > 0.f)) {
-				const glm::vec3 R = reflect(L, N);
-				specular = std::pow(std::max(0.f, glm::dot(R, V)), mat.n) * mat.k_s;
-			}
+	if (params.light_sampling == RaytracingParameters::LIGHT_SAMPLING_BVH && !scene->light_bvh.empty()) {
+		// unbiased estimate from a few lights, sampled by their estimated contribution.
+		// the ambient term does not depend on N, so lights behind P still contribute.
+		const int num_samples = std::max(1, params.light_samples);
+		for (int s = 0; s < num_samples; ++s) {
+			float pdf = 0.f;
+			const int l = scene->light_bvh.sample(P, N, (F & FEATURE_AMBIENT) != 0, data.tld->rand(), &pdf);
+			if (l < 0)
+				continue;
+			contribution += evaluate_phong_light<F>(data, mat, P, N, V, size_t(l)) / (pdf * float(num_samples));
 		}
+		return contribution;
+	}
 
-		glm::vec3 ambient = data.context.params.ambient ? mat.k_a : glm::vec3(0.0f);
-
-		// TODO: modify this and implement the phong model as specified on the exercise sheet
-		const float dist = glm::length(light->getPosition() - P);
-		contribution += (visibility * (diffuse + specular) + ambient) * light->getEmission(-L) / (dist*dist);
+	// iterate over lights and sum up their contribution
+	for (size_t l = 0; l < scene->lights.size(); ++l) {
+		contribution += evaluate_phong_light<F>(data, mat, P, N, V, l);
 	}
 
 	return contribution;
 }
 
-glm::vec3 evaluate_reflection(
+template <unsigned F>
+static glm::vec3 evaluate_reflection_kernel(
 	RenderData & data,
 	int depth,
 	glm::vec3 const& P, // world space position
 	glm::vec3 const& N, // Normal (already normalized)
-	glm::vec3 const& V) // View vector (already normalized)
+	glm::vec3 const& V, // View vector (already normalized)
+	glm::vec3 const& throughput)
 {
 	// TODO: calculate reflective contribution by contructing and shooting a reflection ray.
 	const glm::vec3 R = reflect(V, N);
 	Ray ray_reflection(P + data.context.params.ray_epsilon * R, R);
-	return trace_recursive(data, ray_reflection, depth + 1);
+	return trace_recursive_kernel<F>(data, ray_reflection, depth + 1, throughput);
 }
 
-glm::vec3 evaluate_transmission(
+template <unsigned F>
+static glm::vec3 evaluate_transmission_kernel(
 	RenderData & data,
 	int depth,          // recursion depth
 	glm::vec3 const& P, // world space position
 	glm::vec3 const& N, // Normal (already normalized)
 	glm::vec3 const& V, // View vector (already normalized)
-	float eta)
+	float eta,
+	glm::vec3 const& throughput)
 {
 	// TODO: calculate transmissive contribution by constructing and shooting a transmission ray.
 	glm::vec3 contribution(0.f);
@@ -274,56 +411,103 @@ glm::vec3 evaluate_transmission(
 	if (refract(V, N, eta, &T))
 	{
 		Ray ray_transmission(P + data.context.params.ray_epsilon * T, T);
-		contribution = trace_recursive(data, ray_transmission, depth + 1);
+		contribution = trace_recursive_kernel<F>(data, ray_transmission, depth + 1, throughput);
 	}
 	return contribution;
 }
 
-glm::vec3 handle_transmissive_material_single_ior(
+template <unsigned F>
+static glm::vec3 handle_transmissive_material_single_ior_kernel(
 	RenderData &data,			// class containing raytracing information
 	int depth,					// the current recursion depth
 	glm::vec3 const& P,			// world space position
 	glm::vec3 const& N,			// normal at the position (already normalized)
 	glm::vec3 const& V,			// view vector (already normalized)
-	float eta)					// the relative refraction index
+	float eta,					// the relative refraction index
+	glm::vec3 const& throughput)	// path throughput up to P
 {
 	if (data.context.params.fresnel) {
 		// TODO: implement fresnel handling here.
-		const float F = fresnel(V, N, eta);
+		const float F_r = fresnel(V, N, eta);
+
+		cg_assert(F_r >= 0.f);
+		cg_assert(F_r <= 1.f);
 
-		cg_assert(F >= 0.f);
-		cg_assert(F <= 1.f);
+		if (data.context.params.stochastic_fresnel) {
+			// choose one branch with probability F_r, the weight F_r/F_r cancels
+			if (data.tld->rand() < F_r) {
+				return evaluate_reflection_kernel<F>(data, depth, P, N, V, throughput);
+			}
+			return evaluate_transmission_kernel<F>(data, depth, P, N, V, eta, throughput);
+		}
 
-		return     	  F * evaluate_reflection(data, depth, P, N, V)
-			+ (1.f - F) * evaluate_transmission(data, depth, P, N, V, eta);
+		return     	  F_r * evaluate_reflection_kernel<F>(data, depth, P, N, V, F_r * throughput)
+			+ (1.f - F_r) * evaluate_transmission_kernel<F>(data, depth, P, N, V, eta, (1.f - F_r) * throughput);
 	}
 	else {
 		// just regular transmission
-		return evaluate_transmission(data, depth, P, N, V, eta);
+		return evaluate_transmission_kernel<F>(data, depth, P, N, V, eta, throughput);
 	}
 }
 
+template <unsigned F>
+static glm::vec3 handle_transmissive_material_spectral_kernel(
+	RenderData & data,
+	int depth,
+	glm::vec3 const& P,
+	glm::vec3 const& N,
+	glm::vec3 const& V,
+	glm::vec3 const& eta_of_channel,
+	glm::vec3 const& throughput)
+{
+	if (data.wavelength > 0.f) {
+		// the path already follows a hero wavelength, its weight has been applied
+		const float eta = dispersion_ior(eta_of_channel, data.wavelength);
+		return handle_transmissive_material_single_ior_kernel<F>(data, depth, P, N, V, eta, throughput);
+	}
 
-glm::vec3 handle_transmissive_material(
+	const float u = data.wavelength_sample >= 0.f ? data.wavelength_sample : data.tld->rand();
+	data.wavelength = sample_wavelength(u);
+	const glm::vec3 weight = wavelength_to_rgb_weight(data.wavelength);
+	const float eta = dispersion_ior(eta_of_channel, data.wavelength);
+
+	const glm::vec3 contribution = weight
+		* handle_transmissive_material_single_ior_kernel<F>(data, depth, P, N, V, eta, throughput * weight);
+
+	// other subtrees of the path are free to pick their own wavelength
+	data.wavelength = 0.f;
+	return contribution;
+}
+
+template <unsigned F>
+static glm::vec3 handle_transmissive_material_kernel(
 	RenderData & data,
 	int depth,          // recursion depth
 	glm::vec3 const& P, // world space position
 	glm::vec3 const& N, // Normal (already normalized)
 	glm::vec3 const& V, // View vector (already normalized)
-	glm::vec3 const& eta_of_channel)
+	glm::vec3 const& eta_of_channel,
+	glm::vec3 const& throughput)
 {
 	if (data.context.params.dispersion && !(eta_of_channel[0] == eta_of_channel[1] && eta_of_channel[0] == eta_of_channel[2])) {
+		if (data.context.params.spectral_dispersion) {
+			return handle_transmissive_material_spectral_kernel<F>(data, depth, P, N, V, eta_of_channel, throughput);
+		}
+
 		// TODO: split ray into 3 rays (one for each color channel) and implement dispersion here
 		glm::vec3 contribution(0.f);
 		for (int i = 0; i < 3; ++i) {
 			float eta = eta_of_channel[i];
-			contribution[i] += handle_transmissive_material_single_ior(data, depth, P, N, V, eta)[i];
+			// only channel i of the child ray is used
+			glm::vec3 throughput_of_channel(0.f);
+			throughput_of_channel[i] = throughput[i];
+			contribution[i] += handle_transmissive_material_single_ior_kernel<F>(data, depth, P, N, V, eta, throughput_of_channel)[i];
 		}
 		return contribution;
 	}
 	else {
 		const float eta = 1.f/3.f*(eta_of_channel[0]+eta_of_channel[1]+eta_of_channel[2]);
-		return handle_transmissive_material_single_ior(data, depth, P, N, V, eta);
+		return handle_transmissive_material_single_ior_kernel<F>(data, depth, P, N, V, eta, throughput);
 	}
 	return glm::vec3(0.f);
 }
@@ -349,13 +533,115 @@ env_map_lookup(RenderData &data, const glm::vec3 &dir)
 	}
 }
 
-glm::vec3 trace_recursive(RenderData & data, Ray const& ray, int depth)
+/*
+ * the color of the hit isect of ray, see trace_recursive
+ */
+template <unsigned F>
+static glm::vec3 shade_hit_kernel(RenderData & data, Ray const& ray, int depth, Intersection const& isect, glm::vec3 const& path_throughput)
+{
+    glm::vec3 contribution(0.f);
+
+    MaterialSample mat = isect.material;
+	if (data.context.params.diffuse_white_mode) {
+		mat.k_a = glm::vec3(0.1f);
+		mat.k_d = glm::vec3(1.0f);
+		mat.k_s = glm::vec3(0.0f);
+		mat.k_r = glm::vec3(0.0f);
+		mat.k_t = glm::vec3(0.0f);
+	}
+    const glm::vec3 N = data.context.params.normal_mapping ? isect.shading_normal : isect.normal;
+    const glm::vec3 V = -ray.direction;
+    const bool hit_backside = glm::dot(isect.geometric_normal, V) < 0.f;
+
+    if (!hit_backside) {
+		contribution = evaluate_phong_kernel<F>(data, mat, isect.position, N, V);
+    }
+
+    // recursive tracing
+    if (!hit_backside && data.context.params.reflection && glm::length(mat.k_r) > 0.f) {
+		contribution += mat.k_r * evaluate_reflection_kernel<F>(data, depth, isect.position, N, V, path_throughput * mat.k_r);
+    }
+    if (data.context.params.transmission && glm::length(mat.k_t) > 0.f) {
+		contribution += mat.k_t * handle_transmissive_material_kernel<F>(data, depth, isect.position, N, V, mat.eta, path_throughput * mat.k_t);
+    }
+
+    return contribution;
+}
+
+/*
+ * trace_recursive for the primary ray of the left eye of a stereo pixel.
+ * The primary ray of the right eye through the same sample is traced
+ * along with it, its color is added to data.stereo.
+ */
+template <unsigned F>
+static glm::vec3 trace_stereo_kernel(RenderData & data, Ray const& ray, glm::vec3 const& throughput)
+{
+	const bool footprint = data.context.params.tex_filter_mode == TextureFilterMode::TRILINEAR
+	                    || data.context.params.tex_filter_mode == TextureFilterMode::DEBUG_MIP;
+	const Camera::Mode camera_mode = data.camera_mode;
+
+	Ray rays[2] = { ray, Ray() };
+	Ray corner_rays[8];
+	for (int e = 0; e < 2; ++e) {
+		data.camera_mode = e == 0 ? Camera::StereoLeft : Camera::StereoRight;
+		if (e == 1)
+			rays[1] = createPrimaryRay(data, data.x, data.y);
+		if (footprint) {
+			// the corners of the pixel footprint, as in trace_recursive
+			corner_rays[4 * e + 0] = createPrimaryRay(data, (data.x - 0.5f), (data.y - 0.5f));
+			corner_rays[4 * e + 1] = createPrimaryRay(data, (data.x + 0.5f), (data.y + 0.5f));
+			corner_rays[4 * e + 2] = createPrimaryRay(data, (data.x - 0.5f), (data.y + 0.5f));
+			corner_rays[4 * e + 3] = createPrimaryRay(data, (data.x + 0.5f), (data.y - 0.5f));
+		}
+	}
+	data.camera_mode = camera_mode;
+
+	Intersection isects[2];
+	const unsigned found = shoot_stereo_rays(data, rays, footprint ? corner_rays : nullptr, isects);
+
+	glm::vec3 colors[2];
+	for (int e = 0; e < 2; ++e) {
+		if (!(found & (1u << e))) {
+			colors[e] = env_map_lookup(data, rays[e].direction);
+			continue;
+		}
+		if (e == 0)
+			data.isect = isects[0];
+		colors[e] = shade_hit_kernel<F>(data, rays[e], 0, isects[e], throughput);
+	}
+
+	data.stereo->right += colors[1];
+	data.stereo->num_samples++;
+	return colors[0];
+}
+
+template <unsigned F>
+static glm::vec3 trace_recursive_kernel(RenderData & data, Ray const& ray, int depth, glm::vec3 const& throughput)
 {
     if (depth > data.context.params.max_depth) {
         return glm::vec3(0.f);
     }
+    if (data.stereo && depth == 0) {
+        return trace_stereo_kernel<F>(data, ray, throughput);
+    }
+
+	// terminate paths that cannot contribute noticeably to the pixel
+	float weight = 1.f;
+	if (depth > 0) {
+		const float max_throughput = std::max(throughput.x, std::max(throughput.y, throughput.z));
+		if (max_throughput <= data.context.params.min_throughput) {
+			return glm::vec3(0.f);
+		}
+		if (data.context.params.russian_roulette && depth >= data.context.params.rr_min_depth) {
+			const float survival = std::min(1.f, max_throughput);
+			if (data.tld->rand() >= survival) {
+				return glm::vec3(0.f);
+			}
+			weight = 1.f / survival;
+		}
+	}
+	const glm::vec3 path_throughput = weight * throughput;
 
-    glm::vec3 contribution(0.f);
     Intersection isect;
 
 	bool found_intersection = false;
@@ -381,30 +667,119 @@ glm::vec3 trace_recursive(RenderData & data, Ray const& ray, int depth)
     if(depth == 0)
 		data.isect = isect;
 
-    MaterialSample mat = isect.material;
-	if (data.context.params.diffuse_white_mode) {
-		mat.k_a = glm::vec3(0.1f);
-		mat.k_d = glm::vec3(1.0f);
-		mat.k_s = glm::vec3(0.0f);
-		mat.k_r = glm::vec3(0.0f);
-		mat.k_t = glm::vec3(0.0f);
-	}
-    const glm::vec3 N = data.context.params.normal_mapping ? isect.shading_normal : isect.normal;
-    const glm::vec3 V = -ray.direction;
-    const bool hit_backside = glm::dot(isect.geometric_normal, V) < 0.f;
+    return weight * shade_hit_kernel<F>(data, ray, depth, isect, path_throughput);
+}
 
-    if (!hit_backside) {
-		contribution = evaluate_phong(data, mat, isect.position, N, V);
-    }
+template <unsigned F>
+static ShadingKernels make_shading_kernels()
+{
+	ShadingKernels kernels;
+	kernels.evaluate_phong                          = &evaluate_phong_kernel<F>;
+	kernels.evaluate_reflection                     = &evaluate_reflection_kernel<F>;
+	kernels.evaluate_transmission                   = &evaluate_transmission_kernel<F>;
+	kernels.handle_transmissive_material_single_ior = &handle_transmissive_material_single_ior_kernel<F>;
+	kernels.handle_transmissive_material_spectral   = &handle_transmissive_material_spectral_kernel<F>;
+	kernels.handle_transmissive_material            = &handle_transmissive_material_kernel<F>;
+	kernels.trace_recursive                         = &trace_recursive_kernel<F>;
+	return kernels;
+}
 
-    // recursive tracing
-    if (!hit_backside && data.context.params.reflection && glm::length(mat.k_r) > 0.f) {
-		contribution += mat.k_r * evaluate_reflection(data, depth, isect.position, N, V);
-    }
-    if (data.context.params.transmission && glm::length(mat.k_t) > 0.f) {
-		contribution += mat.k_t * handle_transmissive_material(data, depth, isect.position, N, V, mat.eta);
-    }
+/*
+ * the kernels of the feature combinations F..., in this order
+ */
+template <unsigned... F>
+struct ShadingKernelTable
+{
+	ShadingKernels kernels[sizeof...(F)] = { make_shading_kernels<F>()... };
+};
 
-    return contribution;
+ShadingKernels const& select_shading_kernels(RaytracingParameters const& params)
+{
+	static_assert(FEATURE_COMBINATIONS == 16, "list all feature combinations below");
+	static const ShadingKernelTable<0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15> table;
+	return table.kernels[shading_features(params)];
+}
+
+/*
+ * the kernels selected for the current launch, see HostRender::launch
+ */
+static ShadingKernels const& active_kernels(RenderData const& data)
+{
+	return data.context.shading_kernels
+		? *data.context.shading_kernels
+		: select_shading_kernels(data.context.params);
+}
+
+glm::vec3 evaluate_phong(
+	RenderData &data,
+	MaterialSample const& mat,
+	glm::vec3 const& P,
+	glm::vec3 const& N,
+	glm::vec3 const& V)
+{
+	return active_kernels(data).evaluate_phong(data, mat, P, N, V);
+}
+
+glm::vec3 evaluate_reflection(
+	RenderData & data,
+	int depth,
+	glm::vec3 const& P,
+	glm::vec3 const& N,
+	glm::vec3 const& V,
+	glm::vec3 const& throughput)
+{
+	return active_kernels(data).evaluate_reflection(data, depth, P, N, V, throughput);
+}
+
+glm::vec3 evaluate_transmission(
+	RenderData & data,
+	int depth,
+	glm::vec3 const& P,
+	glm::vec3 const& N,
+	glm::vec3 const& V,
+	float eta,
+	glm::vec3 const& throughput)
+{
+	return active_kernels(data).evaluate_transmission(data, depth, P, N, V, eta, throughput);
+}
+
+glm::vec3 handle_transmissive_material_single_ior(
+	RenderData &data,
+	int depth,
+	glm::vec3 const& P,
+	glm::vec3 const& N,
+	glm::vec3 const& V,
+	float eta,
+	glm::vec3 const& throughput)
+{
+	return active_kernels(data).handle_transmissive_material_single_ior(data, depth, P, N, V, eta, throughput);
+}
+
+glm::vec3 handle_transmissive_material_spectral(
+	RenderData & data,
+	int depth,
+	glm::vec3 const& P,
+	glm::vec3 const& N,
+	glm::vec3 const& V,
+	glm::vec3 const& eta_of_channel,
+	glm::vec3 const& throughput)
+{
+	return active_kernels(data).handle_transmissive_material_spectral(data, depth, P, N, V, eta_of_channel, throughput);
+}
+
+glm::vec3 handle_transmissive_material(
+	RenderData & data,
+	int depth,
+	glm::vec3 const& P,
+	glm::vec3 const& N,
+	glm::vec3 const& V,
+	glm::vec3 const& eta_of_channel,
+	glm::vec3 const& throughput)
+{
+	return active_kernels(data).handle_transmissive_material(data, depth, P, N, V, eta_of_channel, throughput);
 }
 
+glm::vec3 trace_recursive(RenderData & data, Ray const& ray, int depth, glm::vec3 const& throughput)
+{
+	return active_kernels(data).trace_recursive(data, ray, depth, throughput);
+}
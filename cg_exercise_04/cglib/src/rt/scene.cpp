@@ -14,6 +14,8 @@
 #include <cglib/core/camera.h>
 #include <cglib/core/image.h>
 
+#include <algorithm>
+#include <iostream>
 #include <sstream>
 #include <random>
 
@@ -28,6 +30,51 @@ set_active_camera()
 		camera->set_active();
 }
 
+void Scene::
+compile_materials()
+{
+	material_table.clear();
+	for (auto& o : objects) {
+		o->material_index = o->material ? material_table.add(*o->material) : -1;
+	}
+	for (auto& soup : soups) {
+		soup->material_table_offset = material_table.size();
+		for (auto const& m : soup->materials)
+			material_table.add(m);
+	}
+}
+
+void Scene::
+build_light_bvh()
+{
+	light_bvh.build(lights);
+}
+
+void Scene::
+compress_textures()
+{
+	std::vector<std::string> names;
+	for (auto const& t : textures)
+		names.push_back(t.first);
+	std::sort(names.begin(), names.end());
+
+	const double MB = 1024.0 * 1024.0;
+	std::size_t total_before = 0, total_after = 0;
+	for (auto const& name : names) {
+		TextureCompressionReport report;
+		if (!textures[name]->compress(&report))
+			continue;
+		total_before += report.size_before;
+		total_after += report.size_after;
+		std::cout << name << ": " << report.width << "x" << report.height << " "
+			<< TiledImage::format_names[report.format] << ", "
+			<< report.size_before / MB << " MB -> " << report.size_after / MB << " MB, "
+			<< "PSNR " << report.psnr << " dB" << std::endl;
+	}
+	std::cout << "Texture compression: " << total_before / MB << " MB -> "
+		<< total_after / MB << " MB" << std::endl;
+}
+
 GaussScene::GaussScene(RaytracingParameters& params)
 {
     init_scene(params);
@@ -60,6 +107,13 @@ void GaussScene::refresh_scene(RaytracingParameters const& params)
 	img_src->filter_gaussian_separable(img_tgt_separable.get(), params.sigma, params.kernel_radius * 2 + 1);
 }
 
+ImageTexture const* GaussScene::get_display_texture(RaytracingParameters const& params) const
+{
+	const char *tex_names[RaytracingParameters::GAUSS_MODE_COUNT] = { "input", "filtered_naive", "filtered_separable" };
+	auto it = textures.find(tex_names[params.gauss_mode]);
+	return it != textures.end() ? it->second.get() : nullptr;
+}
+
 FourierScene::FourierScene(RaytracingParameters& params)
 {
     init_scene(params);
@@ -69,6 +123,13 @@ void FourierScene::init_scene(RaytracingParameters const& params)
 {
 }
 
+ImageTexture const* FourierScene::get_display_texture(RaytracingParameters const& params) const
+{
+	const char *tex_names[RaytracingParameters::FOURIER_MODE_COUNT] = { "amplitude", "phase", "reconstructed" };
+	auto it = textures.find(tex_names[params.fourier_mode]);
+	return it != textures.end() ? it->second.get() : nullptr;
+}
+
 void FourierScene::refresh_scene(RaytracingParameters const& params)
 {
 	if(textures.size() > 0)
@@ -233,11 +294,9 @@ void MonkeyScene::init_scene(RaytracingParameters const& params)
 		params.get_tex_wrap_mode(), 2.2f)});
 	textures["floor"]->create_mipmap();
 
-	std::shared_ptr<Image> appartment = std::make_shared<Image>();
-	appartment->load("assets/appartment.jpg", 1.f);
     textures.insert({"appartment_env",          
-		std::make_shared<ImageTexture>(*appartment,
-		BILINEAR, REPEAT)});
+		std::make_shared<ImageTexture>("assets/appartment.jpg",
+		BILINEAR, REPEAT, 1.f)});
 	textures["appartment_env"]->create_mipmap();
 	env_map = textures["appartment_env"].get();
 	
@@ -255,6 +314,8 @@ void MonkeyScene::init_scene(RaytracingParameters const& params)
         glm::vec2(4.f))));
     objects.back()->material->k_d = textures["floor"];
 
+	if (params.compress_textures)
+		compress_textures();
 
     lights.emplace_back(new Light(
 		glm::vec3(0.f, 6.f, 12.f), glm::vec3(3.f)));
@@ -304,6 +365,9 @@ void SponzaScene::init_scene(RaytracingParameters const& params)
 	for (int i = 0; i < 2; ++i) {
 		lights.emplace_back(new Light(glm::vec3(-2.5f+5.f*i, 6.f, 0.f), glm::vec3(10.f)));
 	}
+
+	if (params.compress_textures)
+		compress_textures();
 }
 
 void SponzaScene::refresh_scene(RaytracingParameters const& params)
@@ -313,8 +377,8 @@ void SponzaScene::refresh_scene(RaytracingParameters const& params)
 		scene_loaded = true;
 	}
 	for (auto &tex : textures) {
-		tex.second->filter_mode = params.get_tex_filter_mode();
-		tex.second->wrap_mode = params.get_tex_wrap_mode();
+		tex.second->set_filter_mode(params.get_tex_filter_mode());
+		tex.second->set_wrap_mode(params.get_tex_wrap_mode());
 	}
 }
 
@@ -0,0 +1,86 @@
+#include <cglib/rt/spectrum.h>
+
+#include <cglib/colors/cmf.h>
+#include <cglib/core/assert.h>
+
+#include <algorithm>
+#include <cmath>
+
+/*
+ * CIE XYZ to linear sRGB.
+ */
+static glm::vec3 xyz_to_rgb(glm::vec3 const& xyz)
+{
+	const glm::mat3 M ( // Column-major!
+		3.2404542, -0.9692660, 0.0556434,
+		-1.5371385, 1.8760108, -0.2040259,
+		-0.4985314, 0.0415560, 1.0572252
+	);
+	return M * xyz;
+}
+
+float sample_wavelength(float u)
+{
+	cg_assert(u >= 0.f && u <= 1.f);
+	return SPECTRUM_MIN_WAVELENGTH + u * (SPECTRUM_MAX_WAVELENGTH - SPECTRUM_MIN_WAVELENGTH);
+}
+
+/*
+ * linear interpolation of the CIE color matching functions,
+ * converted to linear sRGB. Out of gamut (negative) values are clamped.
+ */
+static glm::vec3 cmf_rgb(float wavelength)
+{
+	auto const& wl = cmf::wavelengths;
+	if (wavelength <= wl.front() || wavelength >= wl.back()) {
+		return glm::vec3(0.f);
+	}
+
+	const size_t i = std::upper_bound(wl.begin(), wl.end(), wavelength) - wl.begin() - 1;
+	const float t = (wavelength - wl[i]) / (wl[i + 1] - wl[i]);
+	const glm::vec3 xyz(
+		glm::mix(cmf::x[i], cmf::x[i + 1], t),
+		glm::mix(cmf::y[i], cmf::y[i + 1], t),
+		glm::mix(cmf::z[i], cmf::z[i + 1], t));
+
+	return glm::max(xyz_to_rgb(xyz), glm::vec3(0.f));
+}
+
+/*
+ * mean of cmf_rgb over the sampled wavelength range, computed once.
+ */
+static glm::vec3 const& cmf_rgb_mean()
+{
+	static const glm::vec3 mean = [] {
+		const int num_steps = 400;
+		const float step = (SPECTRUM_MAX_WAVELENGTH - SPECTRUM_MIN_WAVELENGTH) / num_steps;
+		glm::vec3 sum(0.f);
+		for (int i = 0; i < num_steps; ++i) {
+			sum += cmf_rgb(SPECTRUM_MIN_WAVELENGTH + (i + 0.5f) * step);
+		}
+		return sum / float(num_steps);
+	}();
+	return mean;
+}
+
+glm::vec3 wavelength_to_rgb_weight(float wavelength)
+{
+	// the uniform pdf cancels with the range of the mean
+	return cmf_rgb(wavelength) / cmf_rgb_mean();
+}
+
+float dispersion_ior(glm::vec3 const& eta_of_channel, float wavelength)
+{
+	// representative wavelengths of the red, green and blue channel
+	const glm::vec3 channel_wavelength(610.f, 550.f, 465.f);
+	const glm::vec3 x = 1.f / (channel_wavelength * channel_wavelength);
+
+	// least squares fit of eta = A + B * x
+	const float mean_x = (x[0] + x[1] + x[2]) / 3.f;
+	const float mean_eta = (eta_of_channel[0] + eta_of_channel[1] + eta_of_channel[2]) / 3.f;
+	const glm::vec3 dx = x - mean_x;
+	const float B = glm::dot(dx, eta_of_channel - mean_eta) / glm::dot(dx, dx);
+	const float A = mean_eta - B * mean_x;
+
+	return A + B / (wavelength * wavelength);
+}
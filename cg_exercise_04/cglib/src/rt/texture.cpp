@@ -1,10 +1,17 @@
 #include <cglib/rt/texture.h>
+#include <cglib/rt/texture_cache.h>
 
 #include <cglib/core/image.h>
+#include <cglib/core/tiled_image.h>
 #include <cglib/core/glmstream.h>
 #include <cglib/core/assert.h>
+#include <cglib/core/page_cache.h>
+#include <cglib/core/parallel_for.h>
+#include <cglib/core/simd.h>
 
 #include <algorithm>
+#include <cmath>
+#include <sstream>
 
 const char* tex_filter_mode_names[TEXTURE_FILTER_MODE_COUNT] = {
 	"Nearest", "Bilinear", "Trilinear", "Debug Mip", "White"
@@ -16,6 +23,10 @@ const char* tex_wrap_mode_names[TEXTURE_WRAP_MODE_COUNT] = {
 	"Zero"
 };
 
+const char* mipmap_filter_names[MIPMAP_FILTER_COUNT] = {
+	"Box", "Kaiser", "Lanczos"
+};
+
 ImageTexture::ImageTexture(
     std::string const& filename,
     TextureFilterMode filter_mode_,
@@ -23,10 +34,16 @@ ImageTexture::ImageTexture(
     float gamma_) :
     Texture(),
     filter_mode(filter_mode_),
-    wrap_mode(wrap_mode_)
+    wrap_mode(wrap_mode_),
+    format(Image::is_hdr(filename) ? TiledImage::RGBA16F : TiledImage::RGBA8),
+    gamma(gamma_),
+    source(filename)
 {
-    mip_levels.emplace_back(new Image());
-    mip_levels.back()->load(filename.c_str(), gamma_);
+    if (!load_cached(MIPMAP_FILTER_BOX, format)) {
+        mip_levels.emplace_back(new Image());
+        mip_levels.back()->load(filename.c_str(), gamma_);
+    }
+    select_lookups();
 }
 
 ImageTexture::ImageTexture(
@@ -38,6 +55,246 @@ ImageTexture::ImageTexture(
     wrap_mode(wrap_mode_)
 {
     mip_levels.emplace_back(new Image(image));
+    select_lookups();
+}
+
+/*
+ * Call f(begin, end) for ranges of rows in [0, rows), in parallel.
+ */
+static void parallel_rows(int rows, ParallelFor& threads, std::function<void(int, int)> const& f)
+{
+	const int rows_per_job = 16;
+	threads.run((rows + rows_per_job - 1) / rows_per_job, [&](int job) {
+		f(job * rows_per_job, std::min(rows, (job + 1) * rows_per_job));
+	});
+}
+
+/*
+ * First source texel and weights of destination texel x of the box filter
+ * along one direction, returns the number of taps. Even sizes average 2
+ * texels. For odd sizes 2n+1, each of the n destination texels covers
+ * (2n+1)/n source texels, which overlap 3 source texels with the weights
+ * (n-x, n, x+1)/(2n+1).
+ */
+static int box_taps(int size, int x, int* first, float weights[3])
+{
+	*first = 2 * x;
+	if (size == 1) {
+		weights[0] = 1.f;
+		return 1;
+	}
+	if (size % 2 == 0) {
+		weights[0] = weights[1] = 0.5f;
+		return 2;
+	}
+	const int n = size / 2;
+	const float inv_size = 1.f / float(size);
+	weights[0] = float(n - x) * inv_size;
+	weights[1] = float(n) * inv_size;
+	weights[2] = float(x + 1) * inv_size;
+	return 3;
+}
+
+/*
+ * dst is src downsampled to half its size, rounded down, in each direction
+ * of size > 1, with the box filter.
+ */
+static void downsample_box(Image const& src, Image* dst, ParallelFor& threads)
+{
+	const int src_width = src.getWidth();
+	const int src_height = src.getHeight();
+	const int width = dst->getWidth();
+	glm::vec4 const* s = src.getPixels();
+	glm::vec4* d = dst->getPixels();
+
+	if ((src_width % 2 == 1 && src_width > 1) || (src_height % 2 == 1 && src_height > 1)) {
+		parallel_rows(dst->getHeight(), threads, [&](int begin, int end) {
+			for (int y = begin; y < end; ++y) {
+				int first_y, first_x;
+				float weights_y[3], weights_x[3];
+				const int taps_y = box_taps(src_height, y, &first_y, weights_y);
+				glm::vec4* out = d + std::size_t(y) * width;
+				for (int x = 0; x < width; ++x) {
+					const int taps_x = box_taps(src_width, x, &first_x, weights_x);
+					float4 sum(0.f);
+					for (int j = 0; j < taps_y; ++j) {
+						glm::vec4 const* row = s + std::size_t(first_y + j) * src_width + first_x;
+						for (int i = 0; i < taps_x; ++i)
+							sum += float4(weights_y[j] * weights_x[i]) * float4(row[i]);
+					}
+					sum.store(out + x);
+				}
+			}
+		});
+		return;
+	}
+
+	// even sizes: average 2x2 (or 2x1, 1x2) texels
+	const int cx = src_width > 1 ? 2 : 1;
+	const int cy = src_height > 1 ? 2 : 1;
+	const float4 scale(1.f / float(cx * cy));
+	parallel_rows(dst->getHeight(), threads, [&](int begin, int end) {
+		for (int y = begin; y < end; ++y) {
+			glm::vec4 const* row0 = s + std::size_t(cy * y) * src_width;
+			glm::vec4 const* row1 = row0 + (cy - 1) * src_width;
+			glm::vec4* out = d + std::size_t(y) * width;
+			for (int x = 0; x < width; ++x) {
+				glm::vec4 const* p0 = row0 + cx * x;
+				glm::vec4 const* p1 = row1 + cx * x;
+				float4 sum(p0[0]);
+				if (cy > 1) sum += float4(p1[0]);
+				if (cx > 1) {
+					sum += float4(p0[1]);
+					if (cy > 1) sum += float4(p1[1]);
+				}
+				(sum * scale).store(out + x);
+			}
+		}
+	});
+}
+
+static float sinc(float x)
+{
+	x *= float(M_PI);
+	return std::abs(x) < 1e-5f ? 1.f : std::sin(x) / x;
+}
+
+// modified Bessel function of the first kind of order 0
+static double bessel_i0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	for (int k = 1; term > 1e-12 * sum; ++k) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+	}
+	return sum;
+}
+
+/*
+ * filter kernel with a radius of 3 (destination texels)
+ */
+static float mipmap_filter_weight(MipmapFilter filter, float x)
+{
+	const float radius = 3.f;
+	if (std::abs(x) >= radius)
+		return 0.f;
+	switch (filter) {
+		case MIPMAP_FILTER_KAISER: {
+			const double alpha = 4.0;
+			const double t = x / radius;
+			return sinc(x) * float(bessel_i0(alpha * std::sqrt(1.0 - t * t)) / bessel_i0(alpha));
+		}
+		case MIPMAP_FILTER_LANCZOS:
+			return sinc(x) * sinc(x / radius);
+		default:
+			return 1.f;
+	}
+}
+
+/*
+ * Source texels and weights of the filter taps of each destination texel
+ * along one direction, downsampling size texels to size / 2, rounded
+ * down. Sizes of 1 are copied.
+ */
+struct MipmapTaps
+{
+	int num_taps;
+	bool fixed_phase;            // the same weights for all destination texels
+	std::vector<float> weights;  // num_taps, per destination texel unless fixed_phase
+	std::vector<int> indices;    // num_taps per destination texel
+
+	MipmapTaps(MipmapFilter filter, TextureWrapMode wrap_mode, int size)
+	{
+		if (size == 1) {
+			num_taps = 1;
+			fixed_phase = true;
+			weights = { 1.f };
+			indices = { 0 };
+			return;
+		}
+
+		// a destination texel is scale source texels wide, the filter
+		// covers radius 3 destination texels. For even sizes, the scale
+		// is 2 and all destination texels are centered between two source
+		// texels, so they share one set of weights.
+		const int dst_size = size / 2;
+		const float scale = float(size) / float(dst_size);
+		const int half = int(std::ceil(3.f * scale));
+		num_taps = 2 * half + 1;
+		fixed_phase = size % 2 == 0;
+		for (int x = 0; x < dst_size; ++x) {
+			const float center = (float(x) + 0.5f) * scale;
+			const int first = int(std::floor(center)) - half;
+			for (int k = 0; k < num_taps; ++k) {
+				const int i = first + k;
+				indices.push_back(wrap_mode == REPEAT
+					? ImageTexture::wrap_repeat(i, size)
+					: ImageTexture::wrap_clamp(i, size));
+			}
+			if (fixed_phase && x > 0)
+				continue;
+			float sum = 0.f;
+			for (int k = 0; k < num_taps; ++k) {
+				weights.push_back(mipmap_filter_weight(filter, (float(first + k) + 0.5f - center) / scale));
+				sum += weights.back();
+			}
+			for (int k = 0; k < num_taps; ++k)
+				weights[x * num_taps + k] /= sum;
+		}
+	}
+
+	float const* weights_of(int x) const { return &weights[fixed_phase ? 0 : x * num_taps]; }
+	int const* indices_of(int x) const { return &indices[x * num_taps]; }
+};
+
+/*
+ * dst is src downsampled to half its size with a separable filter, first along x into
+ * a temporary image, then along y. Negative results of the filter lobes
+ * are clamped to 0.
+ */
+static void downsample_filtered(Image const& src, Image* dst,
+	MipmapFilter filter, TextureWrapMode wrap_mode, ParallelFor& threads)
+{
+	const int src_width = src.getWidth();
+	const int src_height = src.getHeight();
+	const int width = dst->getWidth();
+	const int height = dst->getHeight();
+	const MipmapTaps taps_x(filter, wrap_mode, src_width);
+	const MipmapTaps taps_y(filter, wrap_mode, src_height);
+	const float4 zero(0.f);
+
+	Image tmp(width, src_height);
+	glm::vec4 const* s = src.getPixels();
+	glm::vec4* t = tmp.getPixels();
+	parallel_rows(src_height, threads, [&](int begin, int end) {
+		for (int y = begin; y < end; ++y) {
+			glm::vec4 const* row = s + std::size_t(y) * src_width;
+			glm::vec4* out = t + std::size_t(y) * width;
+			for (int x = 0; x < width; ++x) {
+				int const* idx = taps_x.indices_of(x);
+				float const* w = taps_x.weights_of(x);
+				float4 sum(0.f);
+				for (int k = 0; k < taps_x.num_taps; ++k)
+					sum += float4(w[k]) * float4(row[idx[k]]);
+				sum.store(out + x);
+			}
+		}
+	});
+
+	glm::vec4* d = dst->getPixels();
+	parallel_rows(height, threads, [&](int begin, int end) {
+		for (int y = begin; y < end; ++y) {
+			int const* idx = taps_y.indices_of(y);
+			float const* w = taps_y.weights_of(y);
+			glm::vec4* out = d + std::size_t(y) * width;
+			for (int x = 0; x < width; ++x) {
+				float4 sum(0.f);
+				for (int k = 0; k < taps_y.num_taps; ++k)
+					sum += float4(w[k]) * float4(t[std::size_t(idx[k]) * width + x]);
+				max(sum, zero).store(out + x);
+			}
+		}
+	});
 }
 
 glm::vec4 ImageTexture::
@@ -55,85 +312,510 @@ evaluate(glm::vec2 const& uv, glm::vec2 const& dudv) const
 }
 
 void ImageTexture::
-create_mipmap()
+create_mipmap(MipmapFilter filter, int num_threads)
 {
+	if (cached) {
+		if (filter == mipmap_filter || load_cached(filter, format))
+			return;
+		// the cached levels were computed with another filter
+		tiled_levels.clear();
+		mipmapped = cached = false;
+		mip_levels.emplace_back(new Image());
+		mip_levels.back()->load(source.c_str(), gamma);
+	}
+
+	cg_assert("mipmap already created" && tiled_levels.empty() && mip_levels.size() == 1);
+
 	/* iteratively downsample until only a 1x1 image is left */
 	int size_x = mip_levels[0]->getWidth();
 	int size_y = mip_levels[0]->getHeight();
 
-	cg_assert("must be power of two" && !(size_x & (size_x - 1)));
-	cg_assert("must be power of two" && !(size_y & (size_y - 1)));
-	
+	// level n+1 has half the size of level n, rounded down.
+	// The threads are started once for all levels.
+	ParallelFor threads(num_threads);
 	for (int level = 0; size_x > 1 || size_y > 1; level++)
 	{
-		int const cx = size_x > 1 ? 2 : 1;
-		int const cy = size_y > 1 ? 2 : 1;
 		size_x = std::max(1, size_x/2);
 		size_y = std::max(1, size_y/2);
 		mip_levels.emplace_back(new Image(size_x, size_y));
-		for (int x = 0; x < size_x; x++) {
-			for (int y = 0; y < size_y; y++) {
-				glm::vec4 mean(0.f);
-				for (int xx = 0; xx < cx; xx++) {
-					for (int yy = 0; yy < cy; yy++) {
-						mean += mip_levels[level]->getPixel(2*x+xx, 2*y+yy);
-					}
-				}
-				mip_levels[level+1]->setPixel(x, y, mean/float(cx*cy));
-			}
+		if (filter == MIPMAP_FILTER_BOX)
+			downsample_box(*mip_levels[level], mip_levels[level+1].get(), threads);
+		else
+			downsample_filtered(*mip_levels[level], mip_levels[level+1].get(), filter, wrap_mode, threads);
+	}
+
+	if (layout == TEXTURE_LAYOUT_TILED) {
+		build_tiled_levels();
+		mipmapped = true;
+		mipmap_filter = filter;
+		if (!source.empty()) {
+			TextureCache::store(cache_key(filter, format), tiled_levels);
+			// page the levels from the new entry instead of keeping them
+			if (PageCache::enabled())
+				load_cached(filter, format);
 		}
 	}
 }
 
+std::string ImageTexture::
+cache_key(MipmapFilter filter, TiledImage::Format format_) const
+{
+	std::ostringstream os;
+	os << "gamma " << gamma << " format " << TiledImage::format_names[format_]
+	   << " mipmap " << mipmap_filter_names[filter];
+	// only the wider filters read texels across the border
+	if (filter != MIPMAP_FILTER_BOX)
+		os << " wrap " << tex_wrap_mode_names[wrap_mode];
+	return TextureCache::key(source, os.str());
+}
+
+bool ImageTexture::
+load_cached(MipmapFilter filter, TiledImage::Format format_, double* psnr)
+{
+	if (source.empty() || !TextureCache::enabled() || layout != TEXTURE_LAYOUT_TILED)
+		return false;
+	std::vector<TiledImage> levels;
+	if (!TextureCache::load(cache_key(filter, format_), &levels, psnr))
+		return false;
+	tiled_levels = std::move(levels);
+	mip_levels.clear();
+	format = format_;
+	mipmap_filter = filter;
+	mipmapped = cached = true;
+	return true;
+}
+
+std::vector<std::shared_ptr<ImageTexture>> ImageTexture::
+load_mipmapped(std::vector<std::string> const& filenames,
+	TextureFilterMode filter_mode_, TextureWrapMode wrap_mode_, MipmapFilter filter)
+{
+	// the rows of each texture are computed serially
+	std::vector<std::shared_ptr<ImageTexture>> textures(filenames.size());
+	parallel_for(int(filenames.size()), [&](int i) {
+		textures[i] = std::make_shared<ImageTexture>(filenames[i], filter_mode_, wrap_mode_);
+		textures[i]->create_mipmap(filter, 1);
+	});
+	return textures;
+}
+
+void ImageTexture::
+build_tiled_levels()
+{
+	tiled_levels.clear();
+	tiled_levels.reserve(mip_levels.size());
+	for (auto const& level : mip_levels)
+		tiled_levels.emplace_back(*level, format, gamma);
+	// the tiled levels replace the linear ones
+	mip_levels.clear();
+}
+
+void ImageTexture::
+set_layout(TextureLayout layout_)
+{
+	layout = layout_;
+	if (layout == TEXTURE_LAYOUT_TILED) {
+		if (!mip_levels.empty())
+			build_tiled_levels();
+	}
+	else if (!tiled_levels.empty()) {
+		mip_levels.clear();
+		for (auto const& level : tiled_levels) {
+			mip_levels.emplace_back(new Image());
+			level.copy_to(mip_levels.back().get());
+		}
+		tiled_levels.clear();
+	}
+}
+
+bool ImageTexture::
+compress(TextureCompressionReport* report)
+{
+	if (format != TiledImage::RGBA8 || layout != TEXTURE_LAYOUT_TILED)
+		return false;
+	// textures without mipmap have not been converted yet
+	if (tiled_levels.empty())
+		build_tiled_levels();
+
+	const std::size_t size_before = memory_size();
+
+	double psnr = 0.0;
+	if (mipmapped && (load_cached(mipmap_filter, TiledImage::BC1, &psnr)
+	               || load_cached(mipmap_filter, TiledImage::BC3, &psnr))) {
+		if (report) {
+			report->format = format;
+			report->width = tiled_levels[0].getWidth();
+			report->height = tiled_levels[0].getHeight();
+			report->size_before = size_before;
+			report->size_after = memory_size();
+			report->psnr = psnr;
+		}
+		return true;
+	}
+
+	const TiledImage reference = tiled_levels[0];
+
+	Image level;
+	reference.copy_to(&level);
+	bool transparent = false;
+	for (int i = 0; i < level.getWidth() * level.getHeight(); ++i)
+		transparent = transparent || level.getPixels()[i].a < 1.f;
+	format = transparent ? TiledImage::BC3 : TiledImage::BC1;
+
+	for (auto& tiled : tiled_levels) {
+		tiled.copy_to(&level);
+		tiled = TiledImage(level, format, gamma);
+	}
+
+	psnr = tiled_levels[0].psnr(reference);
+	if (mipmapped && !source.empty()) {
+		TextureCache::store(cache_key(mipmap_filter, format), tiled_levels, psnr);
+		if (PageCache::enabled())
+			load_cached(mipmap_filter, format);
+	}
+
+	if (report) {
+		report->format = format;
+		report->width = reference.getWidth();
+		report->height = reference.getHeight();
+		report->size_before = size_before;
+		report->size_after = memory_size();
+		report->psnr = psnr;
+	}
+	return true;
+}
+
+int ImageTexture::
+num_levels() const
+{
+	return tiled_levels.empty() ? int(mip_levels.size()) : int(tiled_levels.size());
+}
+
+int ImageTexture::
+level_width(int level) const
+{
+	return tiled_levels.empty() ? mip_levels[level]->getWidth() : tiled_levels[level].getWidth();
+}
+
+int ImageTexture::
+level_height(int level) const
+{
+	return tiled_levels.empty() ? mip_levels[level]->getHeight() : tiled_levels[level].getHeight();
+}
+
+std::size_t ImageTexture::
+memory_size() const
+{
+	std::size_t size = 0;
+	for (auto const& level : mip_levels)
+		size += std::size_t(level->getWidth()) * level->getHeight() * sizeof(glm::vec4);
+	for (auto const& level : tiled_levels)
+		size += level.memory_size();
+	return size;
+}
+
+/*
+ * Wrap modes of the specialized lookups. wrap maps the texel coordinate x
+ * into [0, size). ZERO clamps it and sets the weight of the texel to zero
+ * instead of returning a black texel.
+ */
+namespace {
+
+struct WrapRepeatMask // REPEAT for power of two sizes
+{
+	static int wrap(int x, int size, float* /*weight*/) { return x & (size - 1); }
+};
+
+struct WrapRepeat
+{
+	static int wrap(int x, int size, float* /*weight*/)
+	{
+		const int r = x % size;
+		return r < 0 ? r + size : r;
+	}
+};
+
+struct WrapClamp
+{
+	static int wrap(int x, int size, float* /*weight*/) { return std::max(0, std::min(size - 1, x)); }
+};
+
+struct WrapZero
+{
+	static int wrap(int x, int size, float* weight)
+	{
+		*weight = unsigned(x) < unsigned(size) ? *weight : 0.f;
+		return std::max(0, std::min(size - 1, x));
+	}
+};
+
+} // namespace
+
+void ImageTexture::
+gather(int level, int x0, int x1, int y0, int y1, glm::vec4 out[4]) const
+{
+	if (!tiled_levels.empty()) {
+		tiled_levels[level].getPixels(x0, x1, y0, y1, out);
+		return;
+	}
+	glm::vec4 const* pixels = mip_levels[level]->getPixels();
+	const std::size_t width = std::size_t(mip_levels[level]->getWidth());
+	out[0] = pixels[y0 * width + x0];
+	out[1] = pixels[y1 * width + x0];
+	out[2] = pixels[y0 * width + x1];
+	out[3] = pixels[y1 * width + x1];
+}
+
+template <class Wrap>
 glm::vec4 ImageTexture::
-evaluate_nearest(int level, glm::vec2 const& uv) const
+nearest(int level, glm::vec2 const& uv) const
+{
+	int const width = level_width(level);
+	int const height = level_height(level);
+	float weight = 1.f;
+	int const s = Wrap::wrap((int)std::floor(uv[0]*width), width, &weight);
+	int const t = Wrap::wrap((int)std::floor(uv[1]*height), height, &weight);
+	if (!tiled_levels.empty())
+		return weight * tiled_levels[level].getPixel(s, t);
+	return weight * mip_levels[level]->getPixels()[std::size_t(t) * width + s];
+}
+
+/*
+ * Bilinear lookup between the texels ffs-1 and ffs, fft-1 and fft with the
+ * weights ws and wt of the second ones. The channels are blended in one
+ * SIMD register.
+ */
+template <class Wrap>
+float4 ImageTexture::
+bilinear(int level, float ffs, float fft, float ws, float wt) const
 {
-	cg_assert(level >= 0 && level < static_cast<int>(mip_levels.size()));
-	cg_assert(mip_levels[level]);
-	int const width = mip_levels[level]->getWidth();
-	int const height = mip_levels[level]->getHeight();
-	int const s = (int)std::floor(uv[0]*width);
-	int const t = (int)std::floor(uv[1]*height);
-	return get_texel(level, s, t);
+	float wx[2] = { 1.f-ws, ws };
+	float wy[2] = { 1.f-wt, wt };
+	int const x0 = Wrap::wrap(int(ffs-1), level_width(level), &wx[0]);
+	int const x1 = Wrap::wrap(int(ffs), level_width(level), &wx[1]);
+	int const y0 = Wrap::wrap(int(fft-1), level_height(level), &wy[0]);
+	int const y1 = Wrap::wrap(int(fft), level_height(level), &wy[1]);
+
+	glm::vec4 texels[4];
+	gather(level, x0, x1, y0, y1, texels);
+	return float4(wx[0] * wy[0]) * float4(texels[0]) +
+		   float4(wx[0] * wy[1]) * float4(texels[1]) +
+		   float4(wx[1] * wy[0]) * float4(texels[2]) +
+		   float4(wx[1] * wy[1]) * float4(texels[3]);
 }
 
+template <class Wrap>
 glm::vec4 ImageTexture::
-evaluate_bilinear(int level, glm::vec2 const& uv) const
+bilinear(int level, glm::vec2 const& uv) const
 {
-	cg_assert(level >= 0 && level < static_cast<int>(mip_levels.size()));
-	cg_assert(mip_levels[level]);
-	int const width = mip_levels[level]->getWidth();
-	int const height = mip_levels[level]->getHeight();
+	int const width = level_width(level);
+	int const height = level_height(level);
 	float fs = uv[0]*width+0.5f;
 	float ft = uv[1]*height+0.5f;
 	float const ffs = std::floor(fs);
 	float const fft = std::floor(ft);
-	float const ws = fs - ffs;
-	float const wt = ft - fft;
 
-	return (1.f-ws) * (1.f-wt) * get_texel(level, int(ffs-1), int(fft-1)) + 
-		   (1.f-ws) * (    wt) * get_texel(level, int(ffs-1), int(fft)) + 
-		   (    ws) * (1.f-wt) * get_texel(level, int(ffs),   int(fft-1)) + 
-		   (    ws) * (    wt) * get_texel(level, int(ffs),   int(fft)); 
+	glm::vec4 result;
+	bilinear<Wrap>(level, ffs, fft, fs - ffs, ft - fft).store(&result);
+	return result;
 }
 
-glm::vec4 ImageTexture::
-evaluate_trilinear(glm::vec2 const& uv, glm::vec2 const& dudv) const
+void ImageTexture::
+trilinear_levels(glm::vec2 const& dudv, int* lower, int* upper, float* alpha) const
 {
 	const float footprint_size = std::max(1.f, std::max(
-		dudv[0]*mip_levels[0]->getWidth(), dudv[1]*mip_levels[0]->getHeight()));
+		dudv[0]*level_width(0), dudv[1]*level_height(0)));
 
 	const float level = std::log2(footprint_size);
-	const float alpha = glm::fract(level);
-	const int lower = std::min<int>(std::max<int>(0, static_cast<int>(std::floor(level))), mip_levels.size()-1);
-	const int upper = std::min<int>(std::max<int>(0, static_cast<int>(std::ceil(level))), mip_levels.size()-1);
+	*alpha = glm::fract(level);
+	*lower = std::min<int>(std::max<int>(0, static_cast<int>(std::floor(level))), num_levels()-1);
+	*upper = std::min<int>(std::max<int>(0, static_cast<int>(std::ceil(level))), num_levels()-1);
+}
 
-	// visualization of mipmap level
-	//return       alpha  * glm::vec3(float(upper)/(mip_levels.size()-1)) 
-	//    + (1.f - alpha) * glm::vec3(float(lower)/(mip_levels.size()-1));
-	
-	return      alpha * evaluate_bilinear(upper, uv) 
-		+ (1.f-alpha) * evaluate_bilinear(lower, uv);
+template <class Wrap>
+glm::vec4 ImageTexture::
+trilinear(glm::vec2 const& uv, glm::vec2 const& dudv) const
+{
+	int lower, upper;
+	float alpha;
+	trilinear_levels(dudv, &lower, &upper, &alpha);
+
+	// the weights of bilinear<Wrap>(upper, uv) and bilinear<Wrap>(lower, uv)
+	const float4 size(glm::vec4(level_width(upper), level_height(upper),
+	                            level_width(lower), level_height(lower)));
+	const float4 f = float4(glm::vec4(uv, uv)) * size + float4(0.5f);
+	const float4 ff = floor(f);
+	glm::vec4 floors, weights;
+	ff.store(&floors);
+	(f - ff).store(&weights);
+
+	glm::vec4 result;
+	(float4(alpha) * bilinear<Wrap>(upper, floors[0], floors[1], weights[0], weights[1])
+	 + float4(1.f-alpha) * bilinear<Wrap>(lower, floors[2], floors[3], weights[2], weights[3])).store(&result);
+	return result;
+}
+
+void ImageTexture::
+evaluate(int count, ImageTexture const* const textures[],
+	glm::vec2 const& uv, glm::vec2 const& dudv, glm::vec4 out[])
+{
+	// the bilinear lookups (taps) of up to four textures at a time,
+	// two per trilinear lookup
+	const int MAX_TAPS = 8;
+	for (int begin = 0; begin < count; begin += 4) {
+		const int end = std::min(count, begin + 4);
+		ImageTexture const* tap_texture[MAX_TAPS];
+		int tap_level[MAX_TAPS];
+		int tap_lookup[MAX_TAPS];
+		float tap_weight[MAX_TAPS];
+		float width[MAX_TAPS];
+		float height[MAX_TAPS];
+		int num_taps = 0;
+		bool batched[4] = {};
+
+		for (int i = begin; i < end; ++i) {
+			ImageTexture const* texture = textures[i];
+			if (texture->filter_mode != BILINEAR && texture->filter_mode != TRILINEAR) {
+				out[i] = texture->evaluate(uv, dudv);
+				continue;
+			}
+			batched[i - begin] = true;
+			int levels[2] = { 0, 0 };
+			float weights[2] = { 1.f, 0.f };
+			int num_levels = 1;
+			if (texture->filter_mode == TRILINEAR) {
+				texture->trilinear_levels(dudv, &levels[1], &levels[0], &weights[0]);
+				weights[1] = 1.f - weights[0];
+				num_levels = 2;
+			}
+			for (int l = 0; l < num_levels; ++l, ++num_taps) {
+				tap_texture[num_taps] = texture;
+				tap_level[num_taps] = levels[l];
+				tap_lookup[num_taps] = i - begin;
+				tap_weight[num_taps] = weights[l];
+				width[num_taps] = float(texture->level_width(levels[l]));
+				height[num_taps] = float(texture->level_height(levels[l]));
+			}
+		}
+		for (int t = num_taps; t % 4 != 0; ++t)
+			width[t] = height[t] = 1.f;
+
+		// the same computation as in bilinear(level, uv), four taps at a time
+		float ffs[MAX_TAPS], fft[MAX_TAPS], ws[MAX_TAPS], wt[MAX_TAPS];
+		for (int t = 0; t < num_taps; t += 4) {
+			const float4 fs = float4(uv[0]) * float4(width + t) + float4(0.5f);
+			const float4 ft = float4(uv[1]) * float4(height + t) + float4(0.5f);
+			floor(fs).store(ffs + t);
+			floor(ft).store(fft + t);
+			(fs - float4(ffs + t)).store(ws + t);
+			(ft - float4(fft + t)).store(wt + t);
+		}
+
+		float4 sums[4] = { float4(0.f), float4(0.f), float4(0.f), float4(0.f) };
+		for (int t = 0; t < num_taps; ++t) {
+			sums[tap_lookup[t]] += float4(tap_weight[t])
+				* (tap_texture[t]->*tap_texture[t]->bilinear_tap_lookup)(tap_level[t], ffs[t], fft[t], ws[t], wt[t]);
+		}
+		for (int i = begin; i < end; ++i) {
+			if (batched[i - begin])
+				sums[i - begin].store(&out[i]);
+		}
+	}
+}
+
+/*
+ * WHITE and DEBUG_MIP textures are constant per level, their value is
+ * taken from get_texel.
+ */
+glm::vec4 ImageTexture::
+level_constant(int level, glm::vec2 const& /*uv*/) const
+{
+	return get_texel(level, 0, 0);
+}
+
+glm::vec4 ImageTexture::
+trilinear_constant(glm::vec2 const& /*uv*/, glm::vec2 const& dudv) const
+{
+	int lower, upper;
+	float alpha;
+	trilinear_levels(dudv, &lower, &upper, &alpha);
+	return      alpha * get_texel(upper, 0, 0)
+		+ (1.f-alpha) * get_texel(lower, 0, 0);
+}
+
+template <class Wrap>
+void ImageTexture::
+select_wrap_lookups()
+{
+	nearest_lookup = &ImageTexture::nearest<Wrap>;
+	bilinear_lookup = &ImageTexture::bilinear<Wrap>;
+	bilinear_tap_lookup = &ImageTexture::bilinear<Wrap>;
+	trilinear_lookup = &ImageTexture::trilinear<Wrap>;
+}
+
+void ImageTexture::
+select_lookups()
+{
+	// the sizes of all levels are powers of two if those of level 0 are
+	const int width = level_width(0);
+	const int height = level_height(0);
+	power_of_two = ((width & (width - 1)) | (height & (height - 1))) == 0;
+
+	switch (wrap_mode) {
+		case REPEAT:
+			if (power_of_two)
+				select_wrap_lookups<WrapRepeatMask>();
+			else
+				select_wrap_lookups<WrapRepeat>();
+			break;
+		case CLAMP: select_wrap_lookups<WrapClamp>(); break;
+		case ZERO:  select_wrap_lookups<WrapZero>(); break;
+		default:
+			cg_assert(!"Invalid pixel wrap mode.");
+	}
+
+	// the batched lookups in evaluate(count, ...) skip these filters
+	if (filter_mode == WHITE || filter_mode == DEBUG_MIP) {
+		nearest_lookup = &ImageTexture::level_constant;
+		bilinear_lookup = &ImageTexture::level_constant;
+		trilinear_lookup = &ImageTexture::trilinear_constant;
+	}
+}
+
+void ImageTexture::
+set_filter_mode(TextureFilterMode filter_mode_)
+{
+	filter_mode = filter_mode_;
+	select_lookups();
+}
+
+void ImageTexture::
+set_wrap_mode(TextureWrapMode wrap_mode_)
+{
+	wrap_mode = wrap_mode_;
+	select_lookups();
+}
+
+/*
+ * The public lookups call the specialization selected by select_lookups.
+ */
+glm::vec4 ImageTexture::
+evaluate_nearest(int level, glm::vec2 const& uv) const
+{
+	cg_assert(level >= 0 && level < num_levels());
+	return (this->*nearest_lookup)(level, uv);
+}
+
+glm::vec4 ImageTexture::
+evaluate_bilinear(int level, glm::vec2 const& uv) const
+{
+	cg_assert(level >= 0 && level < num_levels());
+	return (this->*bilinear_lookup)(level, uv);
+}
+
+glm::vec4 ImageTexture::
+evaluate_trilinear(glm::vec2 const& uv, glm::vec2 const& dudv) const
+{
+	return (this->*trilinear_lookup)(uv, dudv);
 }
 
 
@@ -167,9 +849,9 @@ get_texel(int level, int x, int y) const
 		{ 1, 0, 1, 0 },
 		{ 0, 1, 1, 0 },
 	};
-	cg_assert(level >= 0 && level < int(mip_levels.size()));
-	cg_assert(mip_levels.at(level)->getWidth() > 0);
-	cg_assert(mip_levels.at(level)->getHeight() > 0);
+	cg_assert(level >= 0 && level < num_levels());
+	cg_assert(level_width(level) > 0);
+	cg_assert(level_height(level) > 0);
 
 	if(filter_mode == DEBUG_MIP) {
 		int l = level % (sizeof(mip_level_debug_colors)
@@ -180,18 +862,18 @@ get_texel(int level, int x, int y) const
 	switch (wrap_mode)
 	{
 		case REPEAT:
-			x = TEXTURE_WRAP_CLASS::wrap_repeat(x, mip_levels[level]->getWidth());
-			y = TEXTURE_WRAP_CLASS::wrap_repeat(y, mip_levels[level]->getHeight());
+			x = TEXTURE_WRAP_CLASS::wrap_repeat(x, level_width(level));
+			y = TEXTURE_WRAP_CLASS::wrap_repeat(y, level_height(level));
 			break;
 
 		case CLAMP:
-			x = TEXTURE_WRAP_CLASS::wrap_clamp(x, mip_levels[level]->getWidth());
-			y = TEXTURE_WRAP_CLASS::wrap_clamp(y, mip_levels[level]->getHeight());
+			x = TEXTURE_WRAP_CLASS::wrap_clamp(x, level_width(level));
+			y = TEXTURE_WRAP_CLASS::wrap_clamp(y, level_height(level));
 			break;
 
 		case ZERO:
-			if (x < 0 || x >= mip_levels[level]->getWidth()
-			 || y < 0 || y >= mip_levels[level]->getHeight())
+			if (x < 0 || x >= level_width(level)
+			 || y < 0 || y >= level_height(level))
 			{
 				return glm::vec4(0);
 			}
@@ -201,20 +883,25 @@ get_texel(int level, int x, int y) const
 			return glm::vec4(0);
 	}
 
-	cg_assert(x >= 0 && x < mip_levels[level]->getWidth());
-	cg_assert(y >= 0 && y < mip_levels[level]->getHeight());
+	cg_assert(x >= 0 && x < level_width(level));
+	cg_assert(y >= 0 && y < level_height(level));
 
+	if (!tiled_levels.empty())
+		return tiled_levels[level].getPixel(x, y);
 	return mip_levels[level]->getPixel(x, y);
 }
 
 void ImageTexture::set_texel(int level, int x, int y, glm::vec4 const& value)
 {
-	cg_assert(level >= 0 && level < int(mip_levels.size()));
-	cg_assert(mip_levels.at(level)->getWidth() > 0);
-	cg_assert(mip_levels.at(level)->getHeight() > 0);
-	cg_assert(x >= 0 && x < mip_levels.at(level)->getWidth());
-	cg_assert(y >= 0 && y < mip_levels.at(level)->getHeight());
-	mip_levels[level]->setPixel(x, y, value);
+	cg_assert(level >= 0 && level < num_levels());
+	cg_assert(level_width(level) > 0);
+	cg_assert(level_height(level) > 0);
+	cg_assert(x >= 0 && x < level_width(level));
+	cg_assert(y >= 0 && y < level_height(level));
+	if (!tiled_levels.empty())
+		tiled_levels[level].setPixel(x, y, value);
+	else
+		mip_levels[level]->setPixel(x, y, value);
 }
 
 int ImageTexture::
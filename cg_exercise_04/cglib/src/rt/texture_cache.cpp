@@ -0,0 +1,257 @@
+#include <cglib/rt/texture_cache.h>
+
+#include <cglib/core/assert.h>
+#include <cglib/core/mapped_file.h>
+#include <cglib/core/page_cache.h>
+
+#include <algorithm>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+/*
+ * Cache file layout: FileHeader, the key, the LevelHeader of each level
+ * (at a multiple of 8 bytes), and the pixels of each level (at multiples
+ * of DATA_ALIGNMENT bytes).
+ */
+namespace {
+
+const char MAGIC[8] = { 'C', 'G', 'T', 'E', 'X', 'C', '0', '1' };
+const std::uint32_t VERSION = 1;
+const std::size_t DATA_ALIGNMENT = 64;
+
+struct FileHeader
+{
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t num_levels;
+	std::uint64_t key_size;
+	double psnr;
+};
+
+struct LevelHeader
+{
+	std::int32_t width;
+	std::int32_t height;
+	std::int32_t format;
+	float gamma;
+	std::uint64_t offset;
+	std::uint64_t size;
+};
+
+std::size_t align(std::size_t offset, std::size_t alignment)
+{
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+std::string& directory()
+{
+	static std::string dir;
+	return dir;
+}
+
+/*
+ * <directory>/<file name of the source>-<hash of the key>.cgtex
+ */
+std::string file_path(std::string const& key)
+{
+	const std::string source = key.substr(0, key.find('\n'));
+	const std::size_t slash = source.find_last_of("/\\");
+	const std::string name = slash == std::string::npos ? source : source.substr(slash + 1);
+
+	// FNV-1a
+	std::uint64_t hash = 14695981039346656037ull;
+	for (char c : key) {
+		hash ^= std::uint8_t(c);
+		hash *= 1099511628211ull;
+	}
+	char hex[17];
+	std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+	return directory() + "/" + name + "-" + hex + ".cgtex";
+}
+
+} // namespace
+
+void TextureCache::
+set_directory(std::string const& dir)
+{
+	directory() = dir;
+}
+
+std::string const& TextureCache::
+get_directory()
+{
+	return directory();
+}
+
+std::string TextureCache::
+key(std::string const& source, std::string const& parameters)
+{
+	struct stat st;
+	if (stat(source.c_str(), &st) != 0)
+		return std::string();
+	std::ostringstream os;
+	os << source << "\n"
+	   << static_cast<long long>(st.st_mtime) << " " << static_cast<long long>(st.st_size) << "\n"
+	   << parameters << "\n"
+	   << "version " << VERSION;
+	return os.str();
+}
+
+bool TextureCache::
+load(std::string const& key, std::vector<TiledImage>* levels, double* psnr)
+{
+	if (!enabled() || key.empty())
+		return false;
+
+	// data holds the headers, the first available bytes of the file
+	std::shared_ptr<MappedFile> mapped;
+	std::shared_ptr<PageCache::File> paged;
+	std::vector<char> headers;
+	char const* data;
+	std::size_t size;
+	std::size_t available;
+	if (PageCache::enabled()) {
+		paged = PageCache::open(file_path(key));
+		if (!paged)
+			return false;
+		size = paged->size();
+		headers.resize(std::min(size, PageCache::PAGE_SIZE));
+		if (!paged->read(0, headers.size(), headers.data()))
+			return false;
+		data = headers.data();
+		available = headers.size();
+	}
+	else {
+		mapped = MappedFile::open(file_path(key));
+		if (!mapped)
+			return false;
+		data = static_cast<char const*>(mapped->data());
+		size = available = mapped->size();
+	}
+
+	FileHeader header;
+	if (available < sizeof(header))
+		return false;
+	std::memcpy(&header, data, sizeof(header));
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+	 || sizeof(header) + header.key_size > available
+	 || key.compare(0, std::string::npos, data + sizeof(header), header.key_size) != 0)
+		return false;
+
+	const std::size_t level_offset = align(sizeof(header) + header.key_size, 8);
+	if (level_offset + header.num_levels * sizeof(LevelHeader) > available)
+		return false;
+
+	std::vector<TiledImage> result;
+	for (std::uint32_t l = 0; l < header.num_levels; ++l) {
+		LevelHeader level;
+		std::memcpy(&level, data + level_offset + l * sizeof(LevelHeader), sizeof(level));
+		if (level.format < 0 || level.format >= TiledImage::FORMAT_COUNT
+		 || level.width <= 0 || level.height <= 0
+		 || level.offset % DATA_ALIGNMENT != 0 || level.offset + level.size > size)
+			return false;
+		if (paged)
+			result.emplace_back(level.width, level.height, TiledImage::Format(level.format),
+				level.gamma, paged, level.offset);
+		else
+			result.emplace_back(level.width, level.height, TiledImage::Format(level.format),
+				level.gamma, mapped, data + level.offset);
+		if (result.back().memory_size() != level.size)
+			return false;
+	}
+
+	*levels = std::move(result);
+	if (psnr)
+		*psnr = header.psnr;
+	return true;
+}
+
+void TextureCache::
+store(std::string const& key, std::vector<TiledImage> const& levels, double psnr)
+{
+	if (!enabled() || key.empty())
+		return;
+
+#ifdef _WIN32
+	_mkdir(directory().c_str());
+#else
+	mkdir(directory().c_str(), 0755);
+#endif
+
+	FileHeader header;
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.num_levels = std::uint32_t(levels.size());
+	header.key_size = key.size();
+	header.psnr = psnr;
+
+	const std::size_t level_offset = align(sizeof(header) + key.size(), 8);
+	std::vector<LevelHeader> level_headers;
+	std::size_t offset = level_offset + levels.size() * sizeof(LevelHeader);
+	for (auto const& level : levels) {
+		offset = align(offset, DATA_ALIGNMENT);
+		LevelHeader l;
+		l.width = level.getWidth();
+		l.height = level.getHeight();
+		l.format = level.getFormat();
+		l.gamma = level.getGamma();
+		l.offset = offset;
+		l.size = level.memory_size();
+		level_headers.push_back(l);
+		offset += level.memory_size();
+	}
+
+	// write to a temporary file first, so that concurrent loads never see
+	// partial files. Its name is unique per process and thread, as several
+	// renderers may share the cache directory.
+	const std::string path = file_path(key);
+	std::ostringstream tmp_path;
+#ifdef _WIN32
+	const long long pid = _getpid();
+#else
+	const long long pid = getpid();
+#endif
+	tmp_path << path << ".tmp" << pid << "-" << std::hash<std::thread::id>()(std::this_thread::get_id());
+	{
+		std::ofstream out(tmp_path.str().c_str(), std::ios::out | std::ios::binary);
+		const char padding[DATA_ALIGNMENT] = {};
+		out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+		out.write(key.data(), std::streamsize(key.size()));
+		out.write(padding, std::streamsize(level_offset - sizeof(header) - key.size()));
+		out.write(reinterpret_cast<char const*>(level_headers.data()),
+			std::streamsize(level_headers.size() * sizeof(LevelHeader)));
+		std::size_t written = level_offset + level_headers.size() * sizeof(LevelHeader);
+		for (std::size_t l = 0; l < levels.size(); ++l) {
+			out.write(padding, std::streamsize(level_headers[l].offset - written));
+			cg_assert("paged levels are already cached" && levels[l].getData());
+			out.write(static_cast<char const*>(levels[l].getData()), std::streamsize(level_headers[l].size));
+			written = level_headers[l].offset + level_headers[l].size;
+		}
+		if (!out) {
+			std::cerr << "warning: could not write texture cache file \"" << tmp_path.str() << "\"" << std::endl;
+			out.close();
+			std::remove(tmp_path.str().c_str());
+			return;
+		}
+	}
+#ifdef _WIN32
+	// rename does not replace existing files
+	std::remove(path.c_str());
+#endif
+	std::rename(tmp_path.str().c_str(), path.c_str());
+}
@@ -9,6 +9,7 @@
 #include <cglib/core/glmstream.h>
 #include <cglib/core/assert.h>
 
+#include <algorithm>
 #include <unordered_map>
 
 using uint = unsigned int;
@@ -37,6 +38,20 @@ TriangleSoup(const std::string &obj_path, TextureContainer *textures)
 
 	cg_assert(obj.getModelCount() > 0);
 
+	// The files of the textures that are not in textures yet, loaded
+	// together at the end, and the files of the k_d and k_s textures of
+	// each material, bound once they are loaded.
+	std::vector<std::string> texture_paths;
+	std::vector<std::string> k_d_paths;
+	std::vector<std::string> k_s_paths;
+	auto add_texture = [&](std::string const& path) {
+		if (textures->find(path) == textures->end()
+		 && std::find(texture_paths.begin(), texture_paths.end(), path) == texture_paths.end()) {
+			if (verbose) std::cout << "create texture: " << path << std::endl;
+			texture_paths.push_back(path);
+		}
+	};
+
 	num_triangles = obj.getFaceCount();
 	if (verbose) std::cout << "obj file contains " << num_triangles << " faces" << std::endl;
 
@@ -63,16 +78,10 @@ TriangleSoup(const std::string &obj_path, TextureContainer *textures)
 
 			// --- diffuse
 			auto it = obj_mat.additionalInfo.find("map_Kd");
+			k_d_paths.emplace_back();
 			if(textures && it != obj_mat.additionalInfo.end()) {
-				std::string texturePath = it->second;
-
-                if (textures->find(texturePath) == textures->end()) {
-                    if (verbose) std::cout << "create texture: " << texturePath << std::endl;
-                    textures->insert({texturePath, std::make_shared<ImageTexture>(texturePath, NEAREST, REPEAT)});
-					(*textures)[texturePath]->create_mipmap();
-                }
-
-				mat.k_d = (*textures)[texturePath];
+				add_texture(it->second);
+				k_d_paths.back() = it->second;
 			}
 			else {
 				mat.k_d = std::make_shared<ConstTexture>(obj_mat.diffuse);
@@ -80,15 +89,10 @@ TriangleSoup(const std::string &obj_path, TextureContainer *textures)
 			
 			// --- specular
 			it = obj_mat.additionalInfo.find("map_Ks");
+			k_s_paths.emplace_back();
 			if(textures && it != obj_mat.additionalInfo.end()) {
-				std::string texturePath = it->second;
-
-                if (textures->find(texturePath) == textures->end()) {
-                    if (verbose) std::cout << "create texture: " << texturePath << std::endl;
-                    textures->insert({texturePath, std::make_shared<ImageTexture>(texturePath, NEAREST, REPEAT)});
-                }
-
-				mat.k_s = (*textures)[texturePath];
+				add_texture(it->second);
+				k_s_paths.back() = it->second;
 			}
 			else {
 				mat.k_s = std::make_shared<ConstTexture>(obj_mat.specular);
@@ -108,6 +112,17 @@ TriangleSoup(const std::string &obj_path, TextureContainer *textures)
 	}
     if (verbose) std::cout << "loading faces done" << std::endl;
 
+	if (verbose) std::cout << "loading textures" << std::endl;
+	const auto loaded = ImageTexture::load_mipmapped(texture_paths, NEAREST, REPEAT);
+	for (std::size_t i = 0; i < texture_paths.size(); ++i)
+		textures->insert({texture_paths[i], loaded[i]});
+	for (std::size_t i = 0; i < materials.size(); ++i) {
+		if (!k_d_paths[i].empty())
+			materials[i].k_d = (*textures)[k_d_paths[i]];
+		if (!k_s_paths[i].empty())
+			materials[i].k_s = (*textures)[k_s_paths[i]];
+	}
+
 	if (verbose) std::cout << vertices.size() << " vertices" << std::endl;
 	if (verbose) std::cout << normals.size() << " normals" << std::endl;
 	if (verbose) std::cout << tex_coordinates.size() << " texcoords" << std::endl;